@@ -0,0 +1,179 @@
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <boost/circular_buffer.hpp>
+#include <benchmark/benchmark.h>
+#include <deduplicator/channelHistory.hpp>
+
+// Compares the per-channel duplicate lookup and insertion on in-order and
+// out-of-order workloads.  The legacy path is the original deduplicator
+// algorithm: a linear std::find over a boost::circular_buffer followed by a
+// full std::sort whenever a packet arrives out of order.
+
+namespace
+{
+
+constexpr int64_t PACKET_DURATION{1000000}; // 1 s packets
+constexpr int SAMPLING_RATE{100};
+constexpr int64_t TOLERANCE{15000};
+
+struct LegacyTraceHeader
+{
+    bool operator<(const LegacyTraceHeader &rhs) const
+    {
+        return startTime < rhs.startTime;
+    }
+    bool operator==(const LegacyTraceHeader &rhs) const
+    {
+        return std::abs(rhs.startTime - startTime) < TOLERANCE;
+    }
+    int64_t startTime{0};
+    int samplingRate{SAMPLING_RATE};
+    int nSamples{SAMPLING_RATE};
+};
+
+/// Creates packet start times where lateFraction of the packets arrive
+/// up to maxLateness packets late.
+std::vector<int64_t> createStartTimes(const int nPackets,
+                                      const double lateFraction,
+                                      const int maxLateness)
+{
+    std::vector<int64_t> startTimes(nPackets);
+    for (int i = 0; i < nPackets; ++i)
+    {
+        startTimes[i] = i*PACKET_DURATION;
+    }
+    std::mt19937 generator(86028157);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::uniform_int_distribution<int> lateness(1, std::max(1, maxLateness));
+    for (int i = 0; i < nPackets; ++i)
+    {
+        if (uniform(generator) < lateFraction)
+        {
+            auto j = std::min(nPackets - 1, i + lateness(generator));
+            std::swap(startTimes[i], startTimes[j]);
+        }
+    }
+    return startTimes;
+}
+
+/// Creates packet start times where a gap is backfilled in one burst after
+/// newer packets have already arrived.
+std::vector<int64_t> createBackfill(const int nPackets, const int gapLength)
+{
+    std::vector<int64_t> startTimes;
+    startTimes.reserve(nPackets);
+    for (int i = 0; i < nPackets; i = i + 2*gapLength)
+    {
+        for (int j = i + gapLength; j < std::min(nPackets, i + 2*gapLength); ++j)
+        {
+            startTimes.push_back(j*PACKET_DURATION);
+        }
+        for (int j = i; j < std::min(nPackets, i + gapLength); ++j)
+        {
+            startTimes.push_back(j*PACKET_DURATION);
+        }
+    }
+    return startTimes;
+}
+
+void runLegacy(benchmark::State &state, const std::vector<int64_t> &startTimes)
+{
+    auto capacity = static_cast<int> (state.range(0));
+    for (auto _ : state)
+    {
+        boost::circular_buffer<LegacyTraceHeader> circularBuffer(capacity);
+        int nDuplicates = 0;
+        for (const auto &startTime : startTimes)
+        {
+            LegacyTraceHeader header{startTime};
+            if (std::find(circularBuffer.begin(), circularBuffer.end(),
+                          header) != circularBuffer.end())
+            {
+                nDuplicates = nDuplicates + 1;
+                continue;
+            }
+            if (circularBuffer.empty() ||
+                circularBuffer.back().startTime < header.startTime)
+            {
+                circularBuffer.push_back(header);
+            }
+            else
+            {
+                circularBuffer.push_back(header);
+                std::sort(circularBuffer.begin(), circularBuffer.end());
+            }
+        }
+        benchmark::DoNotOptimize(nDuplicates);
+    }
+    state.SetItemsProcessed(state.iterations()*startTimes.size());
+}
+
+void runChannelHistory(benchmark::State &state,
+                       const std::vector<int64_t> &startTimes)
+{
+    auto capacity = static_cast<int> (state.range(0));
+    for (auto _ : state)
+    {
+        Deduplicator::ChannelHistory history{SAMPLING_RATE};
+        int nDuplicates = 0;
+        for (const auto &startTime : startTimes)
+        {
+            std::chrono::microseconds t{startTime};
+            if (!history.isExpectedNext(t) && history.contains(t))
+            {
+                nDuplicates = nDuplicates + 1;
+                continue;
+            }
+            // Retain as many packets as the legacy buffer
+            history.evict(t - std::chrono::microseconds
+                                  {capacity*PACKET_DURATION});
+            history.insert(t, SAMPLING_RATE);
+        }
+        benchmark::DoNotOptimize(nDuplicates);
+    }
+    state.SetItemsProcessed(state.iterations()*startTimes.size());
+}
+
+constexpr int N_PACKETS{20000};
+
+void BM_LegacyInOrder(benchmark::State &state)
+{
+    runLegacy(state, createStartTimes(N_PACKETS, 0, 0));
+}
+
+void BM_ChannelHistoryInOrder(benchmark::State &state)
+{
+    runChannelHistory(state, createStartTimes(N_PACKETS, 0, 0));
+}
+
+void BM_LegacyOutOfOrder(benchmark::State &state)
+{
+    runLegacy(state, createStartTimes(N_PACKETS, 0.1, 100));
+}
+
+void BM_ChannelHistoryOutOfOrder(benchmark::State &state)
+{
+    runChannelHistory(state, createStartTimes(N_PACKETS, 0.1, 100));
+}
+
+void BM_LegacyBackfill(benchmark::State &state)
+{
+    runLegacy(state, createBackfill(N_PACKETS, 300));
+}
+
+void BM_ChannelHistoryBackfill(benchmark::State &state)
+{
+    runChannelHistory(state, createBackfill(N_PACKETS, 300));
+}
+
+}
+
+BENCHMARK(BM_LegacyInOrder)->Arg(1000)->Arg(3601);
+BENCHMARK(BM_ChannelHistoryInOrder)->Arg(1000)->Arg(3601);
+BENCHMARK(BM_LegacyOutOfOrder)->Arg(1000)->Arg(3601);
+BENCHMARK(BM_ChannelHistoryOutOfOrder)->Arg(1000)->Arg(3601);
+BENCHMARK(BM_LegacyBackfill)->Arg(1000)->Arg(3601);
+BENCHMARK(BM_ChannelHistoryBackfill)->Arg(1000)->Arg(3601);
+BENCHMARK_MAIN();
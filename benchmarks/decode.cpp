@@ -0,0 +1,150 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <deduplicator/traceBuf2.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/channelInterner.hpp>
+#include <deduplicator/channelHistory.hpp>
+#include "traceBuf2Message.hpp"
+
+// Times the per-packet steps on the read and dedup paths: decoding a
+// message for each data type and byte order, building the channel key from
+// the header, finding the channel, and searching a channel's history at
+// several depths.  The out-of-order insert is timed by channelHistoryBenchmark.
+
+namespace
+{
+
+using Deduplicator::Benchmarks::createMessage;
+
+constexpr int N_SAMPLES{100};
+constexpr double SAMPLING_RATE{100};
+constexpr double START_TIME{1700000000};
+constexpr int64_t PACKET_DURATION{1000000}; // 1 s packets
+
+/// Station names for nChannels channels
+std::vector<std::string> createStations(const int nChannels)
+{
+    std::vector<std::string> stations(nChannels);
+    for (int i = 0; i < nChannels; ++i)
+    {
+        stations[i] = "S" + std::to_string(i);
+    }
+    return stations;
+}
+
+/// The owning decode which copies the samples
+void BM_FromEarthworm(benchmark::State &state, const std::string &dataType)
+{
+    auto message = createMessage("ABC", START_TIME, dataType);
+    Deduplicator::TraceBuf2 traceBuf2;
+    for (auto _ : state)
+    {
+        traceBuf2.fromEarthworm(message.data(), message.size());
+        benchmark::DoNotOptimize(traceBuf2.getStartTime());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations()*message.size());
+}
+
+/// What the deduplicator does for each packet: a view over the ring's
+/// bytes with the times unpacked from the header
+void BM_TraceBuf2View(benchmark::State &state, const std::string &dataType)
+{
+    auto message = createMessage("ABC", START_TIME, dataType);
+    for (auto _ : state)
+    {
+        Deduplicator::TraceBuf2View view{message.data(), message.size()};
+        benchmark::DoNotOptimize(view.getStartTime());
+        benchmark::DoNotOptimize(view.getEndTime());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ChannelKeyFromHeader(benchmark::State &state)
+{
+    auto message = createMessage("ABC", START_TIME);
+    for (auto _ : state)
+    {
+        auto key = Deduplicator::ChannelKey::fromHeader(message.data());
+        benchmark::DoNotOptimize(key);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Finds each packet's channel among state.range(0) channels
+void BM_ChannelInternerFind(benchmark::State &state)
+{
+    auto nChannels = static_cast<int> (state.range(0));
+    auto stations = createStations(nChannels);
+    Deduplicator::ChannelInterner interner;
+    std::vector<Deduplicator::ChannelKey> keys;
+    keys.reserve(nChannels);
+    for (const auto &station : stations)
+    {
+        keys.emplace_back("UU", station, "HHZ", "01");
+        benchmark::DoNotOptimize(interner.intern(keys.back()));
+    }
+    // Packets arrive in no particular channel order
+    std::shuffle(keys.begin(), keys.end(), std::mt19937 {86028157});
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(interner.find(keys[i]));
+        i = i + 1;
+        if (i == keys.size()){i = 0;}
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Searches a history holding state.range(0) packets for start times that
+/// are, half the time, already in the history
+void BM_ChannelHistoryContains(benchmark::State &state)
+{
+    auto depth = static_cast<int> (state.range(0));
+    Deduplicator::ChannelHistory history{SAMPLING_RATE};
+    for (int i = 0; i < depth; ++i)
+    {
+        history.insert(std::chrono::microseconds {i*PACKET_DURATION},
+                       N_SAMPLES);
+    }
+    std::mt19937 generator(86028157);
+    std::uniform_int_distribution<int64_t> packet(0, depth - 1);
+    std::vector<std::chrono::microseconds> queries(4096);
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        // Odd queries fall between packets so they are not found
+        auto offset = (i % 2 == 0) ? 0 : PACKET_DURATION/2;
+        queries[i] = std::chrono::microseconds
+                     {packet(generator)*PACKET_DURATION + offset};
+    }
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(history.contains(queries[i]));
+        i = (i + 1) % queries.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK_CAPTURE(BM_FromEarthworm, i2, std::string {"i2"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, i4, std::string {"i4"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, f4, std::string {"f4"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, f8, std::string {"f8"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, s2, std::string {"s2"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, s4, std::string {"s4"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, t4, std::string {"t4"});
+BENCHMARK_CAPTURE(BM_FromEarthworm, t8, std::string {"t8"});
+BENCHMARK_CAPTURE(BM_TraceBuf2View, i4, std::string {"i4"});
+BENCHMARK_CAPTURE(BM_TraceBuf2View, s4, std::string {"s4"});
+BENCHMARK(BM_ChannelKeyFromHeader);
+BENCHMARK(BM_ChannelInternerFind)->Arg(100)->Arg(2000)->Arg(50000);
+BENCHMARK(BM_ChannelHistoryContains)->Arg(60)->Arg(1200)->Arg(3600);
+BENCHMARK_MAIN();
@@ -0,0 +1,142 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <benchmark/benchmark.h>
+#include <deduplicator/packetBatch.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include "traceBuf2Message.hpp"
+
+// Compares checking a ring scrape's times one packet at a time through the
+// views with unpacking the headers into a PacketBatch and computing the
+// expired and future masks over the arrays.
+
+namespace
+{
+
+using Deduplicator::Benchmarks::createMessage;
+
+constexpr double NOW{1700000000};
+constexpr double EARLIEST_TIME{NOW - 1200};
+constexpr double LATEST_TIME{NOW};
+constexpr std::chrono::microseconds EARLIEST_TIME_MUS
+{
+    static_cast<int64_t> (EARLIEST_TIME*1000000)
+};
+constexpr std::chrono::microseconds LATEST_TIME_MUS
+{
+    static_cast<int64_t> (LATEST_TIME*1000000)
+};
+
+/// A scrape where roughly 1 in 8 packets is expired and 1 in 8 is in the
+/// future so the branches are not perfectly predictable
+struct Scrape
+{
+    explicit Scrape(const int nPackets)
+    {
+        messages.reserve(nPackets);
+        for (int i = 0; i < nPackets; ++i)
+        {
+            double startTime{NOW - 10};
+            auto hash = (static_cast<uint32_t> (i)*2654435761u) >> 29;
+            if (hash == 0){startTime = EARLIEST_TIME - 60;}
+            if (hash == 1){startTime = NOW + 60;}
+            messages.push_back(createMessage("S" + std::to_string(i),
+                                             startTime));
+        }
+        for (const auto &message : messages)
+        {
+            views.emplace_back(message.data(), message.size());
+        }
+    }
+    std::vector<std::vector<char>> messages;
+    std::vector<Deduplicator::TraceBuf2View> views;
+};
+
+/// What the engine did before the packet batch, i.e., unpack the header
+/// fields it needs through the view then check the times
+void BM_PerObject(benchmark::State &state)
+{
+    Scrape scrape{static_cast<int> (state.range(0))};
+    std::vector<uint8_t> expired(scrape.views.size());
+    std::vector<uint8_t> future(scrape.views.size());
+    double sumSamplingRate{0};
+    int64_t sumSamples{0};
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < scrape.views.size(); ++i)
+        {
+            const auto &view = scrape.views[i];
+            try
+            {
+                auto startTime = view.getStartTime();
+                auto endTime = view.getEndTime();
+                sumSamplingRate = sumSamplingRate + view.getSamplingRate();
+                sumSamples = sumSamples + view.getNumberOfSamples();
+                expired[i] = startTime < EARLIEST_TIME ? 1 : 0;
+                future[i] = endTime > LATEST_TIME ? 1 : 0;
+            }
+            catch (const std::exception &e)
+            {
+                expired[i] = 0;
+                future[i] = 0;
+            }
+        }
+        benchmark::DoNotOptimize(expired.data());
+        benchmark::DoNotOptimize(future.data());
+    }
+    benchmark::DoNotOptimize(sumSamplingRate);
+    benchmark::DoNotOptimize(sumSamples);
+    state.SetItemsProcessed(state.iterations()*scrape.views.size());
+}
+
+/// Unpacking the headers and computing the masks
+void BM_PacketBatch(benchmark::State &state)
+{
+    Scrape scrape{static_cast<int> (state.range(0))};
+    const bool vectorize = state.range(1) != 0;
+    if (vectorize && !Deduplicator::PacketBatch::haveAVX2())
+    {
+        state.SkipWithError("AVX2 is not supported");
+        return;
+    }
+    Deduplicator::PacketBatch batch;
+    for (auto _ : state)
+    {
+        batch.set(scrape.views, nullptr);
+        batch.computeTimeMasks(EARLIEST_TIME_MUS, LATEST_TIME_MUS,
+                               vectorize);
+        benchmark::DoNotOptimize(batch.getExpiredMask().data());
+        benchmark::DoNotOptimize(batch.getFutureMask().data());
+    }
+    state.SetItemsProcessed(state.iterations()*scrape.views.size());
+}
+
+/// Only the masks
+void BM_TimeMasks(benchmark::State &state)
+{
+    Scrape scrape{static_cast<int> (state.range(0))};
+    const bool vectorize = state.range(1) != 0;
+    if (vectorize && !Deduplicator::PacketBatch::haveAVX2())
+    {
+        state.SkipWithError("AVX2 is not supported");
+        return;
+    }
+    Deduplicator::PacketBatch batch;
+    batch.set(scrape.views, nullptr);
+    for (auto _ : state)
+    {
+        batch.computeTimeMasks(EARLIEST_TIME_MUS, LATEST_TIME_MUS,
+                               vectorize);
+        benchmark::DoNotOptimize(batch.getExpiredMask().data());
+        benchmark::DoNotOptimize(batch.getFutureMask().data());
+    }
+    state.SetItemsProcessed(state.iterations()*scrape.views.size());
+}
+
+}
+
+BENCHMARK(BM_PerObject)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_PacketBatch)->ArgsProduct({{256, 1024, 4096}, {0, 1}});
+BENCHMARK(BM_TimeMasks)->ArgsProduct({{256, 1024, 4096}, {0, 1}});
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <benchmark/benchmark.h>
+#include <deduplicator/shardedEngine.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include "traceBuf2Message.hpp"
+
+// Measures how the engine's throughput scales with the number of shards.
+// Every batch holds one 1 s packet from each channel, i.e., a ring scrape
+// from a large network in steady state.
+
+namespace
+{
+
+using Deduplicator::Benchmarks::createMessage;
+using Deduplicator::Benchmarks::shiftMessage;
+
+constexpr double START_TIME{1700000000};
+constexpr int N_BATCHES{10};
+
+struct Batches
+{
+    explicit Batches(const int nChannels)
+    {
+        messages.reserve(N_BATCHES*nChannels);
+        for (int batch = 0; batch < N_BATCHES; ++batch)
+        {
+            for (int channel = 0; channel < nChannels; ++channel)
+            {
+                messages.push_back(
+                    createMessage("S" + std::to_string(channel),
+                                  START_TIME + batch));
+            }
+        }
+        views.resize(N_BATCHES);
+        for (int batch = 0; batch < N_BATCHES; ++batch)
+        {
+            for (int channel = 0; channel < nChannels; ++channel)
+            {
+                const auto &message = messages[batch*nChannels + channel];
+                views[batch].emplace_back(message.data(), message.size());
+            }
+        }
+    }
+    /// Moves every packet later in time
+    void shift(const double seconds)
+    {
+        for (auto &message : messages)
+        {
+            shiftMessage(seconds, &message);
+        }
+    }
+    std::vector<std::vector<char>> messages;
+    std::vector<std::vector<Deduplicator::TraceBuf2View>> views;
+};
+
+void BM_ShardedEngine(benchmark::State &state)
+{
+    auto nShards = static_cast<int> (state.range(0));
+    auto nChannels = static_cast<int> (state.range(1));
+    Batches batches{nChannels};
+    std::chrono::microseconds now
+    {
+        static_cast<int64_t> ((START_TIME + N_BATCHES)*1000000)
+    };
+    Deduplicator::ShardedEngine engine{nShards};
+    engine.setCircularBufferDuration(std::chrono::seconds {60});
+    std::vector<Deduplicator::Decision> decisions;
+    // Create the channel histories before timing
+    for (const auto &views : batches.views)
+    {
+        engine.process(views, now, &decisions);
+    }
+    int batch{0};
+    for (auto _ : state)
+    {
+        if (batch == 0)
+        {
+            // Move on to the next chunk of time so nothing is a duplicate
+            state.PauseTiming();
+            batches.shift(N_BATCHES);
+            now = now + std::chrono::seconds {N_BATCHES};
+            state.ResumeTiming();
+        }
+        engine.process(batches.views[batch], now, &decisions);
+        benchmark::DoNotOptimize(decisions.data());
+        batch = (batch + 1)%N_BATCHES;
+    }
+    state.SetItemsProcessed(state.iterations()*nChannels);
+}
+
+}
+
+BENCHMARK(BM_ShardedEngine)
+    ->ArgsProduct({{1, 2, 4, 8}, {1000, 5000}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,28 @@
+#ifndef DEDUPLICATOR_BENCHMARKS_TRACEBUF2_MESSAGE_HPP
+#define DEDUPLICATOR_BENCHMARKS_TRACEBUF2_MESSAGE_HPP
+#include <vector>
+#include <string>
+#include <deduplicator/channelKey.hpp>
+#include "traceBuf2Builder.hpp"
+/// @brief The tracebuf2 messages the benchmarks run on.
+namespace Deduplicator::Benchmarks
+{
+
+using TraceBuf2Builder::shiftMessage;
+
+/// @result A tracebuf2 message from channel UU.station.HHZ.01.
+/// @param[in] station       The station name.
+/// @param[in] startTime     The time of the first sample in seconds from
+///                          the epoch.
+/// @param[in] dataType      The data type, e.g., i4 or t8.
+inline std::vector<char> createMessage(const std::string &station,
+                                       const double startTime,
+                                       const std::string &dataType = "i4")
+{
+    return TraceBuf2Builder::createMessage(ChannelKey {"UU", station,
+                                                       "HHZ", "01"},
+                                           startTime, dataType, 100, 100);
+}
+
+}
+#endif
@@ -0,0 +1,141 @@
+#ifndef DEDUPLICATOR_CAPTURE_RECORDER_HPP
+#define DEDUPLICATOR_CAPTURE_RECORDER_HPP
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+namespace Deduplicator
+{
+/// @class CaptureRecorder "captureRecorder.hpp" "deduplicator/captureRecorder.hpp"
+/// @brief Records the raw messages taken off an input ring, along with
+///        their logo, arrival time, and sequence number, to rotating
+///        capture files.  The reader only copies each message into a
+///        preallocated buffer and a background thread writes the full
+///        buffers so recording does not slow the read path.  If the writer
+///        falls behind and every buffer is full then messages are dropped
+///        from the capture, never from the ring.  A capture can be replayed
+///        at its original timing with the \c FileRing.
+/// @note \c record() and \c flush() must be called from one thread, i.e.,
+///       the thread that reads the ring.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class CaptureRecorder
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    CaptureRecorder();
+    /// @}
+
+    /// @name Parameters
+    /// @{
+
+    /// @brief Sets the size at which a new capture file is started.
+    /// @param[in] fileSize  The file size in bytes.
+    /// @throws std::invalid_argument if this is less than 1 MB.
+    /// @throws std::runtime_error if the recorder is running.
+    void setMaximumFileSize(size_t fileSize);
+    /// @result The maximum file size.  By default this is 256 MB.
+    [[nodiscard]] size_t getMaximumFileSize() const noexcept;
+    /// @brief Sets the number of capture files to keep.  Once a new file
+    ///        would exceed this the oldest file is deleted.
+    /// @param[in] nFiles  The number of files.  If this is 0 then no files
+    ///                    are deleted.
+    /// @throws std::invalid_argument if this is negative.
+    /// @throws std::runtime_error if the recorder is running.
+    void setMaximumNumberOfFiles(int nFiles);
+    /// @result The number of files to keep.  By default this is 8.
+    [[nodiscard]] int getMaximumNumberOfFiles() const noexcept;
+    /// @brief Sets the preallocated buffers.
+    /// @param[in] bufferSize  The size of each buffer in bytes.  This is
+    ///                        limited to the maximum file size.
+    /// @param[in] nBuffers    The number of buffers.
+    /// @throws std::invalid_argument if the buffer size is less than 64 kB
+    ///         or there are fewer than 2 buffers.
+    /// @throws std::runtime_error if the recorder is running.
+    void setBuffers(size_t bufferSize, int nBuffers);
+    /// @result The size of each buffer.  By default this is 4 MB.
+    [[nodiscard]] size_t getBufferSize() const noexcept;
+    /// @result The number of buffers.  By default this is 8.
+    [[nodiscard]] int getNumberOfBuffers() const noexcept;
+    /// @brief Sets how long a partially filled buffer may wait before it is
+    ///        written.  This bounds what a crash can lose.
+    /// @throws std::invalid_argument if this is negative.
+    void setFlushInterval(const std::chrono::milliseconds &interval);
+    /// @result The flush interval.  By default this is 1 second.
+    [[nodiscard]] std::chrono::milliseconds getFlushInterval() const noexcept;
+    /// @}
+
+    /// @name Recording
+    /// @{
+
+    /// @brief Allocates the buffers and starts the writer thread.
+    /// @param[in] directory  The directory to which the captures are
+    ///                       written.  This is created if it does not exist.
+    /// @param[in] prefix     Each capture file is named prefix.time.dcap
+    ///                       where time is the creation time in
+    ///                       microseconds from the epoch, e.g., the ring
+    ///                       name.
+    /// @throws std::invalid_argument if the prefix is empty.
+    /// @throws std::runtime_error if the recorder is running or the
+    ///         directory cannot be created.
+    void start(const std::filesystem::path &directory,
+               const std::string &prefix);
+    /// @result True indicates the recorder is running.
+    [[nodiscard]] bool isRunning() const noexcept;
+    /// @brief Copies a message taken off the ring into the current buffer.
+    /// @param[in] message         The raw message.
+    /// @param[in] length          The length of the message in bytes.
+    /// @param[in] installation    The logo's installation identifier.
+    /// @param[in] module          The logo's module identifier.
+    /// @param[in] type            The logo's message type.
+    /// @param[in] sequenceNumber  The ring's sequence number for the logo.
+    /// @param[in] arrivalTime     When the message was taken off the ring
+    ///                            in microseconds from the epoch.
+    /// @note This does nothing if the recorder is not running.
+    void record(const char *message, size_t length,
+                unsigned char installation,
+                unsigned char module,
+                unsigned char type,
+                unsigned char sequenceNumber,
+                const std::chrono::microseconds &arrivalTime) noexcept;
+    /// @brief Hands the current buffer to the writer thread if it has
+    ///        waited longer than the flush interval.  This is intended to
+    ///        be called after each read of the ring.
+    /// @param[in] force  If true then the buffer is handed off regardless.
+    void flush(bool force = false) noexcept;
+    /// @brief Writes the buffered messages then stops the writer thread.
+    void stop();
+    /// @}
+
+    /// @name Statistics
+    /// @{
+
+    /// @result The number of messages recorded.
+    [[nodiscard]] int64_t getNumberOfRecordedMessages() const noexcept;
+    /// @result The number of messages that could not be recorded because
+    ///         every buffer was waiting to be written.
+    [[nodiscard]] int64_t getNumberOfDroppedMessages() const noexcept;
+    /// @result The number of bytes written to the capture files.
+    [[nodiscard]] int64_t getNumberOfBytesWritten() const noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Destructor.  This stops the recorder.
+    ~CaptureRecorder();
+    /// @}
+
+    CaptureRecorder(const CaptureRecorder &) = delete;
+    CaptureRecorder(CaptureRecorder &&) noexcept = delete;
+    CaptureRecorder& operator=(const CaptureRecorder &) = delete;
+    CaptureRecorder& operator=(CaptureRecorder &&) noexcept = delete;
+private:
+    class CaptureRecorderImpl;
+    std::unique_ptr<CaptureRecorderImpl> pImpl;
+};
+}
+#endif
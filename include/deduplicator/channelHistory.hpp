@@ -0,0 +1,118 @@
+#ifndef DEDUPLICATOR_CHANNEL_HISTORY_HPP
+#define DEDUPLICATOR_CHANNEL_HISTORY_HPP
+#include <vector>
+#include <chrono>
+#include <cstdint>
+namespace Deduplicator
+{
+/// @class ChannelHistory "channelHistory.hpp" "deduplicator/channelHistory.hpp"
+/// @brief The recently seen packet headers for a single channel.  The start
+///        times and sample counts are held in separate arrays of a circular
+///        buffer, sorted by start time, while the sampling rate is stored
+///        once for the channel.  Retention is by time - packets are evicted
+///        with \c evict() - and the buffer grows and shrinks with the number
+///        of packets retained so memory tracks the channel's data rate.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class ChannelHistory
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    ChannelHistory() = default;
+    /// @brief Initializes the history.
+    /// @param[in] samplingRate  The channel's nominal sampling rate in Hz.
+    /// @throws std::invalid_argument if samplingRate is not positive.
+    explicit ChannelHistory(double samplingRate);
+    /// @}
+
+    /// @name Properties
+    /// @{
+
+    /// @result True indicates the history was initialized.
+    [[nodiscard]] bool isInitialized() const noexcept;
+    /// @result The channel's nominal sampling rate in Hz.
+    [[nodiscard]] double getSamplingRate() const noexcept;
+    /// @result The tolerance on start times within which two packets are
+    ///         considered the same.  This is zero if the sampling rate could
+    ///         not be classified in which case nothing is a duplicate.
+    [[nodiscard]] std::chrono::microseconds getTolerance() const noexcept;
+    /// @result The number of packets that can be retained before the
+    ///         buffer must grow.
+    [[nodiscard]] int getCapacity() const noexcept;
+    /// @result The number of packets retained.
+    [[nodiscard]] int size() const noexcept;
+    /// @result True indicates no packets are retained.
+    [[nodiscard]] bool empty() const noexcept;
+    /// @result The approximate number of bytes held by this history.
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+    /// @}
+
+    /// @name Packets
+    /// @{
+
+    /// @param[in] startTime  The start time of a packet in microseconds
+    ///                       from the epoch.
+    /// @result True indicates the packet starts, within the tolerance, one
+    ///         sample after the newest packet ends.  Such a packet cannot be
+    ///         a duplicate so the caller can skip \c contains().
+    /// @note This is O(1) and is the steady-state fast path.
+    [[nodiscard]] bool isExpectedNext(std::chrono::microseconds startTime) const noexcept;
+    /// @result The start time predicted for the next packet.  This is only
+    ///         meaningful when the history is not empty.
+    [[nodiscard]] std::chrono::microseconds getExpectedNextStartTime() const noexcept;
+    /// @param[in] startTime  The start time of a packet in microseconds
+    ///                       from the epoch.
+    /// @result True indicates a packet whose start time is within the
+    ///         tolerance of this start time was already seen.
+    /// @note This is a binary search so it is O(log n).
+    [[nodiscard]] bool contains(std::chrono::microseconds startTime) const noexcept;
+    /// @brief Adds a packet to the history.  If the history is full then the
+    ///        buffer doubles.
+    /// @note Appending the newest packet is amortized O(1).  A late packet
+    ///       is located
+    ///       with a binary search then the shorter side of the buffer is
+    ///       shifted by one slot to make room.
+    /// @param[in] startTime  The start time of the packet in microseconds
+    ///                       from the epoch.
+    /// @param[in] nSamples   The number of samples in the packet.
+    /// @throws std::runtime_error if \c isInitialized() is false.
+    void insert(std::chrono::microseconds startTime, int nSamples);
+    /// @brief Removes the packets that start before the given time.  If the
+    ///        buffer becomes mostly empty then it shrinks.
+    /// @param[in] oldestStartTime  Packets starting before this time, in
+    ///                             microseconds from the epoch, are removed.
+    /// @result The number of packets removed.
+    /// @note This is O(1) when nothing is removed.
+    int evict(std::chrono::microseconds oldestStartTime) noexcept;
+    /// @param[in] index  The packet index where 0 is the oldest packet.
+    ///                   This must be in the range [0, \c size()).
+    /// @result The start time of the index'th packet.
+    [[nodiscard]] std::chrono::microseconds getStartTime(int index) const noexcept;
+    /// @param[in] index  The packet index where 0 is the oldest packet.
+    ///                   This must be in the range [0, \c size()).
+    /// @result The number of samples in the index'th packet.
+    [[nodiscard]] int getNumberOfSamples(int index) const noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Removes all packets but retains the sampling rate.
+    void clear() noexcept;
+    /// @}
+private:
+    [[nodiscard]] int toPhysicalIndex(int index) const noexcept;
+    [[nodiscard]] int upperBound(int64_t startTime) const noexcept;
+    void resize(int capacity);
+    std::vector<int64_t> mStartTimes;
+    std::vector<int32_t> mSamples;
+    int64_t mTolerance{0};
+    int64_t mExpectedNextStartTime{0};
+    double mSamplingRate{0};
+    int mHead{0};
+    int mSize{0};
+};
+}
+#endif
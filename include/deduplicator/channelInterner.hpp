@@ -0,0 +1,92 @@
+#ifndef DEDUPLICATOR_CHANNEL_INTERNER_HPP
+#define DEDUPLICATOR_CHANNEL_INTERNER_HPP
+#include <memory>
+#include <string>
+namespace Deduplicator
+{
+ class ChannelKey;
+}
+namespace Deduplicator
+{
+/// @class ChannelInterner "channelInterner.hpp" "deduplicator/channelInterner.hpp"
+/// @brief Maps channel keys to dense integer identifiers.  The identifiers
+///        are assigned in order of first appearance, starting at 0, and
+///        never change so they can index per-channel state directly.
+///        The keys are held in a flat open-addressing table so interning
+///        a packet's channel is typically a single probe.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class ChannelInterner
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    ChannelInterner();
+    /// @brief Move constructor.
+    /// @param[in,out] interner  The interner from which to initialize this
+    ///                          class.  On exit, interner's behavior is
+    ///                          undefined.
+    ChannelInterner(ChannelInterner &&interner) noexcept;
+    /// @}
+
+    /// @name Operators
+    /// @{
+
+    /// @brief Move assignment.
+    /// @param[in,out] interner  The interner whose memory will be moved to
+    ///                          this.  On exit, interner's behavior is
+    ///                          undefined.
+    /// @result The memory from interner moved to this.
+    ChannelInterner& operator=(ChannelInterner &&interner) noexcept;
+    /// @}
+
+    /// @name Interning
+    /// @{
+
+    /// @param[in] key  The channel key.
+    /// @result The identifier of the channel.  If the channel has not been
+    ///         seen then it is assigned the next identifier.
+    [[nodiscard]] int intern(const ChannelKey &key);
+    /// @param[in] key  The channel key.
+    /// @result The identifier of the channel or -1 if the channel has not
+    ///         been interned.
+    [[nodiscard]] int find(const ChannelKey &key) const noexcept;
+    /// @result The number of interned channels.  Identifiers are in the
+    ///         range [0, \c size()).
+    [[nodiscard]] int size() const noexcept;
+    /// @}
+
+    /// @name Lookup
+    /// @{
+
+    /// @param[in] identifier  The channel identifier.
+    /// @result The channel key corresponding to the identifier.
+    /// @throws std::invalid_argument if the identifier is not in the
+    ///         range [0, \c size()).
+    [[nodiscard]] const ChannelKey &getKey(int identifier) const;
+    /// @param[in] identifier  The channel identifier.
+    /// @result The human-readable name, e.g., UU.CTU.HHZ.01.  This is built
+    ///         on demand and is intended for logging.
+    /// @throws std::invalid_argument if the identifier is not in the
+    ///         range [0, \c size()).
+    [[nodiscard]] std::string getName(int identifier) const;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Releases all interned channels.  The table keeps its size.
+    void clear() noexcept;
+    /// @brief Destructor.
+    ~ChannelInterner();
+    /// @}
+
+    ChannelInterner(const ChannelInterner &) = delete;
+    ChannelInterner& operator=(const ChannelInterner &) = delete;
+private:
+    class ChannelInternerImpl;
+    std::unique_ptr<ChannelInternerImpl> pImpl;
+};
+}
+#endif
@@ -0,0 +1,64 @@
+#ifndef DEDUPLICATOR_CHANNEL_KEY_HPP
+#define DEDUPLICATOR_CHANNEL_KEY_HPP
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdint>
+namespace Deduplicator
+{
+/// @class ChannelKey "channelKey.hpp" "deduplicator/channelKey.hpp"
+/// @brief A fixed-width network, station, channel, location code key.  This
+///        is packed directly from bytes 32 - 54 of a tracebuf2 header so
+///        identifying a channel does not require building a string.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class ChannelKey
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    ChannelKey() = default;
+    /// @brief Packs the key from a tracebuf2 message header.
+    /// @param[in] header  The tracebuf2 message.  This must have at least
+    ///                    64 bytes.
+    [[nodiscard]] static ChannelKey fromHeader(const char *header) noexcept;
+    /// @brief Packs the key from the individual codes.
+    /// @param[in] network   The network code.
+    /// @param[in] station   The station name.
+    /// @param[in] channel   The channel name.
+    /// @param[in] location  The location code.
+    /// @note Codes that are too long will be truncated.
+    ChannelKey(std::string_view network,
+               std::string_view station,
+               std::string_view channel,
+               std::string_view location) noexcept;
+    /// @}
+
+    /// @name Properties
+    /// @{
+
+    /// @result The network code.
+    [[nodiscard]] std::string_view getNetwork() const noexcept;
+    /// @result The station name.
+    [[nodiscard]] std::string_view getStation() const noexcept;
+    /// @result The channel name.
+    [[nodiscard]] std::string_view getChannel() const noexcept;
+    /// @result The location code.
+    [[nodiscard]] std::string_view getLocationCode() const noexcept;
+    /// @result The human-readable name, e.g., UU.CTU.HHZ.01.  If the
+    ///         location code is empty then it is omitted.
+    [[nodiscard]] std::string toName() const;
+    /// @result A 64-bit hash of the key.
+    [[nodiscard]] uint64_t getHash() const noexcept;
+    /// @}
+
+    /// @result True indicates the keys are identical.
+    [[nodiscard]] bool operator==(const ChannelKey &rhs) const noexcept = default;
+private:
+    // Same layout as the header with everything after each field's NULL
+    // terminator zeroed so the bytes can be compared directly.
+    std::array<char, 24> mBytes{};
+};
+}
+#endif
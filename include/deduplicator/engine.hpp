@@ -0,0 +1,254 @@
+#ifndef DEDUPLICATOR_ENGINE_HPP
+#define DEDUPLICATOR_ENGINE_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <span>
+#include <chrono>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+namespace Deduplicator
+{
+ class TraceBuf2View;
+ class ShardedEngine;
+ namespace Snapshot
+ {
+  struct Channel;
+ }
+}
+namespace Deduplicator
+{
+/// @brief Defines what the engine decided to do with a packet.
+enum class Decision : int8_t
+{
+    Accept = 0,    /*!< The packet should be passed on. */
+    Duplicate = 1, /*!< The packet was already seen. */
+    Expired = 2,   /*!< The packet starts too far in the past. */
+    Future = 3,    /*!< The packet ends too far in the future. */
+    Invalid = 4    /*!< The packet header could not be interpreted or there
+                        is no message. */
+};
+
+/// @class Engine "engine.hpp" "deduplicator/engine.hpp"
+/// @brief The deduplication engine.  Batches of packets are processed
+///        against a clock and, for each packet, the engine decides whether
+///        the packet should be passed on or rejected.  The engine retains
+///        a short history of every channel it has seen as well as the
+///        channels that had bad data.
+/// @note This class has no dependency on Earthworm so it can be embedded in
+///       other acquisition processes.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class Engine
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    Engine();
+    /// @brief Move constructor.
+    /// @param[in,out] engine  The engine from which to initialize this
+    ///                        class.  On exit, engine's behavior is
+    ///                        undefined.
+    Engine(Engine &&engine) noexcept;
+    /// @}
+
+    /// @name Operators
+    /// @{
+
+    /// @brief Move assignment.
+    /// @param[in,out] engine  The engine whose memory will be moved to this.
+    ///                        On exit, engine's behavior is undefined.
+    /// @result The memory from engine moved to this.
+    Engine& operator=(Engine &&engine) noexcept;
+    /// @}
+
+    /// @name Parameters
+    /// @{
+
+    /// @brief Packets whose start time is older than now minus this
+    ///        duration are rejected as expired.
+    /// @param[in] maximumPastTime  The maximum past time.
+    /// @throws std::invalid_argument if this is negative.
+    void setMaximumPastTime(const std::chrono::seconds &maximumPastTime);
+    /// @result The maximum past time.  By default this is 1200 seconds.
+    [[nodiscard]] std::chrono::seconds getMaximumPastTime() const noexcept;
+    /// @brief Packets whose end time is newer than now plus this duration
+    ///        are rejected as future data.
+    /// @param[in] maximumFutureTime  The maximum future time.
+    /// @throws std::invalid_argument if this is negative.
+    void setMaximumFutureTime(const std::chrono::seconds &maximumFutureTime);
+    /// @result The maximum future time.  By default this is 0 seconds.
+    [[nodiscard]] std::chrono::seconds getMaximumFutureTime() const noexcept;
+    /// @brief Sets the duration of each channel's history.  Packets that
+    ///        start before now minus this duration are forgotten so they can
+    ///        no longer be detected as duplicates.
+    /// @param[in] duration  The duration of the history.
+    /// @throws std::invalid_argument if this is negative.
+    /// @note A channel's history is trimmed when it receives a packet.
+    void setCircularBufferDuration(const std::chrono::seconds &duration);
+    /// @result The duration of each channel's history.  By default this is
+    ///         3600 seconds.
+    [[nodiscard]] std::chrono::seconds getCircularBufferDuration() const noexcept;
+    /// @}
+
+    /// @name Processing
+    /// @{
+
+    /// @brief Processes a batch of packets.
+    /// @param[in] packets     The packets to process.
+    /// @param[in] now         The current time in microseconds from the
+    ///                        epoch.  This defines the expired and future
+    ///                        windows.
+    /// @param[out] decisions  The decision for each packet.  This has
+    ///                        dimension [packets.size()].
+    /// @throws std::invalid_argument if decisions is NULL.
+    void process(std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 std::vector<Decision> *decisions);
+    /// @brief Processes a batch of packets delivered by a given source.
+    ///        When the same channel arrives over several telemetry paths
+    ///        this tracks which path delivered each accepted packet first.
+    /// @param[in] packets     The packets to process.
+    /// @param[in] now         The current time in microseconds from the
+    ///                        epoch.
+    /// @param[in] source      The index of the source, e.g., input ring,
+    ///                        that delivered the packets.
+    /// @param[out] decisions  The decision for each packet.  This has
+    ///                        dimension [packets.size()].
+    /// @throws std::invalid_argument if source is negative or decisions
+    ///         is NULL.
+    void process(std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 int source,
+                 std::vector<Decision> *decisions);
+    /// @brief Processes a single packet.
+    /// @param[in] packet  The packet to process.
+    /// @param[in] now     The current time in microseconds from the epoch.
+    /// @result The decision for this packet.
+    [[nodiscard]] Decision process(const TraceBuf2View &packet,
+                                   const std::chrono::microseconds &now);
+    /// @brief Adds packets that were already forwarded, e.g., the contents
+    ///        of the output ring at startup, to the channel histories.  No
+    ///        bad channels or first deliveries are recorded.
+    /// @param[in] packets  The packets that were forwarded.
+    /// @param[in] now      The current time in microseconds from the epoch.
+    ///                     Expired and future packets are skipped.
+    /// @result The number of packets added to the histories.
+    int seed(std::span<const TraceBuf2View> packets,
+             const std::chrono::microseconds &now);
+    /// @result The number of distinct channels the engine has seen.
+    [[nodiscard]] int getNumberOfChannels() const noexcept;
+    /// @result The number of channels currently holding a history.
+    [[nodiscard]] int getNumberOfActiveChannels() const noexcept;
+    /// @result The approximate number of bytes held by the engine and its
+    ///         channel histories.
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+    /// @}
+
+    /// @name Reaping
+    /// @{
+
+    /// @brief Sets the approximate number of bytes, as reported by
+    ///        \c getMemoryUsage(), the engine may hold.  When this is
+    ///        exceeded the least recently active channels are released.
+    /// @param[in] budget  The memory budget in bytes.  If this is 0 then
+    ///                    there is no budget.
+    void setMemoryBudget(size_t budget) noexcept;
+    /// @result The memory budget in bytes.  By default this is 0.
+    [[nodiscard]] size_t getMemoryBudget() const noexcept;
+    /// @brief Sets how often \c process() calls \c reap().
+    /// @param[in] interval  The reap interval.  If this is not positive then
+    ///                      the engine never reaps on its own.
+    void setReapInterval(const std::chrono::seconds &interval) noexcept;
+    /// @result The reap interval.  By default this is 60 seconds.
+    [[nodiscard]] std::chrono::seconds getReapInterval() const noexcept;
+    /// @brief Releases the history of every channel that has not had a
+    ///        packet for longer than the maximum past time plus the maximum
+    ///        future time.  Any duplicate of such a channel's history would
+    ///        be rejected as expired so this is safe.  Then, if the memory
+    ///        budget is exceeded by \c getMemoryUsage(), the least recently
+    ///        active channels are released.
+    /// @param[in] now  The current time in microseconds from the epoch.
+    /// @result The number of idle channels released and the number of
+    ///         channels released to meet the memory budget.
+    /// @note Released channels keep their identifiers so a channel that
+    ///       resumes starts a new history.
+    std::pair<int, int> reap(const std::chrono::microseconds &now);
+    /// @}
+
+    /// @name Bad Channels
+    /// @{
+
+    /// @result The names of the channels that had expired data since the
+    ///         last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getExpiredChannels() const;
+    /// @result The names of the channels that had future data since the
+    ///         last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getFutureChannels() const;
+    /// @result The names of the channels that had duplicate data since the
+    ///         last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getDuplicateChannels() const;
+    /// @brief Resets the expired, future, and duplicate channel lists.
+    void clearBadChannels() noexcept;
+    /// @}
+
+    /// @name Snapshots
+    /// @{
+
+    /// @brief Checkpoints the channel histories so that a restarted
+    ///        process can resume without forwarding duplicates.  Only the
+    ///        packets that start after now minus the maximum past time are
+    ///        saved since anything older would be rejected as expired.
+    /// @param[in] fileName  The snapshot file.  This is written atomically.
+    /// @param[in] now       The current time in microseconds from the epoch.
+    /// @throws std::runtime_error if the file cannot be written.
+    void saveSnapshot(const std::filesystem::path &fileName,
+                      const std::chrono::microseconds &now) const;
+    /// @brief Restores the channel histories from a snapshot.  Packets that
+    ///        start before now minus the maximum past time are skipped.
+    /// @param[in] fileName  The snapshot file.
+    /// @param[in] now       The current time in microseconds from the epoch.
+    /// @result The number of channels restored.
+    /// @throws std::invalid_argument if the file does not exist.
+    /// @throws std::runtime_error if the file is not a valid snapshot.
+    /// @note Channels already in the engine are merged with the snapshot.
+    int loadSnapshot(const std::filesystem::path &fileName,
+                     const std::chrono::microseconds &now);
+    /// @}
+
+    /// @name First Deliveries
+    /// @{
+
+    /// @result For each channel with an accepted packet since the last call
+    ///         to \c clearFirstDeliveries(), the channel name and the number
+    ///         of accepted packets each source delivered first.  The i'th
+    ///         count corresponds to source i.
+    [[nodiscard]] std::vector<std::pair<std::string, std::vector<int>>> getFirstDeliveries() const;
+    /// @brief Resets the first delivery counts.
+    void clearFirstDeliveries() noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Releases all channel histories but retains the parameters.
+    void clear() noexcept;
+    /// @brief Destructor.
+    ~Engine();
+    /// @}
+
+    Engine(const Engine &) = delete;
+    Engine& operator=(const Engine &) = delete;
+private:
+    friend class ShardedEngine;
+    [[nodiscard]] std::vector<Snapshot::Channel> exportChannels(const std::chrono::microseconds &now) const;
+    int importChannels(const std::vector<Snapshot::Channel> &channels,
+                       const std::chrono::microseconds &now);
+    class EngineImpl;
+    std::unique_ptr<EngineImpl> pImpl;
+};
+}
+#endif
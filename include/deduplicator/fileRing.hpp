@@ -0,0 +1,191 @@
+#ifndef DEDUPLICATOR_FILE_RING_HPP
+#define DEDUPLICATOR_FILE_RING_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <filesystem>
+#include <deduplicator/iWaveRing.hpp>
+namespace Deduplicator
+{
+ class TraceBuf2View;
+ class MessageSlab;
+}
+namespace Deduplicator
+{
+/// @class FileRing "fileRing.hpp" "deduplicator/fileRing.hpp"
+/// @brief A transport that replays traceBuf2 messages from files in place of
+///        an Earthworm ring.  The files are either tank files, i.e.,
+///        traceBuf2 messages written back to back, or captures made by the
+///        \c CaptureRecorder.  They are memory mapped so large files are not
+///        read into memory up front.  Each message is released once the
+///        replay's virtual clock reaches the message's end time or, for a
+///        capture, the time the message was taken off the ring.  The
+///        virtual clock either jumps forward as fast as the messages can be
+///        read or runs at a multiple of the wall clock.
+///        Alternatively, the ring can be created for writing in which case
+///        the written messages are appended to a tank file.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class FileRing : public IWaveRing
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Default constructor.
+    FileRing();
+    /// @brief Move constructor.
+    /// @param[in,out] fileRing  Initializes the file ring from this class.
+    ///                          On exit, fileRing's behavior is undefined.
+    FileRing(FileRing &&fileRing) noexcept;
+    /// @}
+
+    /// @name Operators
+    /// @{
+
+    /// @brief Move assignment operator.
+    /// @param[in,out] fileRing  The file ring whose memory will be moved to
+    ///                          this.  On exit, fileRing's behavior is
+    ///                          undefined.
+    /// @result The memory from fileRing moved to this.
+    FileRing& operator=(FileRing &&fileRing) noexcept;
+    /// @}
+
+    /// @name Connection
+    /// @{
+
+    /// @brief Opens tank files or captures for replay.  When replaying as
+    ///        fast as possible the messages are replayed in file order, and
+    ///        the files in the given order, so the arrival order, e.g., of
+    ///        late packets, is preserved.  Otherwise, the messages are
+    ///        replayed in order of their release times.
+    /// @param[in] files  The tank files or captures.  A capture's messages
+    ///                   that are not traceBuf2 messages are skipped.
+    /// @throws std::invalid_argument if files is empty or a file does not
+    ///         exist.
+    /// @throws std::runtime_error if a file cannot be mapped or contains a
+    ///         corrupt message.
+    void open(const std::vector<std::filesystem::path> &files);
+    /// @brief Creates a tank file to which the written messages are
+    ///        appended.  An existing file is overwritten.
+    /// @param[in] file  The tank file.
+    /// @throws std::runtime_error if the file cannot be created.
+    void create(const std::filesystem::path &file);
+    /// @result True indicates a file is open for reading or writing.
+    [[nodiscard]] bool isConnected() const noexcept override;
+    /// @result The name of the first file.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    [[nodiscard]] std::string getRingName() const override;
+    /// @result The replay's virtual time in microseconds from the epoch.
+    ///         Before the first read this is the earliest release time.
+    [[nodiscard]] std::chrono::microseconds getNow() const noexcept override;
+    /// @}
+
+    /// @name Replay
+    /// @{
+
+    /// @brief Sets the replay speed.
+    /// @param[in] speed  If this is 0 then the messages are replayed as
+    ///                   fast as possible and the virtual clock is the
+    ///                   latest release time so far.  Otherwise, the
+    ///                   virtual clock runs this many times faster than the
+    ///                   wall clock from the first read, e.g., 1 replays
+    ///                   at the original timing, and the messages are
+    ///                   released in order of their release times.
+    /// @throws std::invalid_argument if speed is negative.
+    void setReplaySpeed(double speed);
+    /// @result The replay speed.  By default this is 0.
+    [[nodiscard]] double getReplaySpeed() const noexcept;
+    /// @brief Sets the most messages released by a single read.
+    /// @param[in] batchSize  The batch size.
+    /// @throws std::invalid_argument if this is not positive.
+    void setMaximumBatchSize(int batchSize);
+    /// @result The most messages released by a read.  By default this
+    ///         is 1024.
+    [[nodiscard]] int getMaximumBatchSize() const noexcept;
+    /// @result The number of messages in the files.
+    [[nodiscard]] int64_t getNumberOfMessages() const noexcept;
+    /// @result The number of messages released so far.
+    [[nodiscard]] int64_t getNumberOfReleasedMessages() const noexcept;
+    /// @}
+
+    /// @name Time Window
+    /// @{
+
+    /// @brief Rejects traceBuf2 messages that are expired or in the future,
+    ///        relative to the virtual clock, while reading.
+    /// @throws std::invalid_argument if either time is negative.
+    /// @sa WaveRing::setTimeWindow()
+    void setTimeWindow(const std::chrono::seconds &maximumPastTime,
+                       const std::chrono::seconds &maximumFutureTime) override;
+    /// @result True indicates the time window was set.
+    [[nodiscard]] bool haveTimeWindow() const noexcept override;
+    /// @result The sorted names of the channels that had expired messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] std::vector<std::string> getExpiredChannels() const override;
+    /// @result The sorted names of the channels that had future messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] std::vector<std::string> getFutureChannels() const override;
+    /// @brief Resets the expired and future channel lists.
+    void clearRejectedChannels() noexcept override;
+    /// @}
+
+    /// @name Reading
+    /// @{
+
+    /// @brief Unlike a ring, nothing lands in a file while the deduplicator
+    ///        is down so this only discards the last read.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    void flush() override;
+    /// @brief Reads the released messages.
+    /// @throws std::runtime_error if the ring is not open for reading.
+    /// @throws TerminateException if every message has been replayed.
+    void read() override;
+    /// @brief Reads the released messages into the caller's storage.
+    /// @param[in,out] messageSlab     On input, a slab whose memory will be
+    ///                                reused.  On exit, the raw messages.
+    /// @param[out] traceBuf2Views     Views of the traceBuf2 messages in
+    ///                                messageSlab.
+    /// @throws std::invalid_argument if either pointer is NULL.
+    /// @throws std::runtime_error if the ring is not open for reading.
+    /// @throws TerminateException if every message has been replayed.
+    void read(MessageSlab *messageSlab,
+              std::vector<TraceBuf2View> *traceBuf2Views) override;
+    /// @result Views of the traceBuf2 messages from the last \c read().
+    /// @note The views are invalidated by the next call to \c read().
+    [[nodiscard]] const std::vector<TraceBuf2View> &getTraceBuf2ViewsReference() const noexcept override;
+    /// @}
+
+    /// @name Writing
+    /// @{
+
+    /// @brief Appends a traceBuf2 message to the file.
+    /// @throws std::runtime_error if the ring is not open for writing or the
+    ///         message could not be written.
+    void write(const TraceBuf2View &message) override;
+    /// @brief Appends a batch of traceBuf2 messages to the file.
+    /// @result The number of messages that were and were not written.
+    /// @throws std::runtime_error if the ring is not open for writing.
+    [[nodiscard]] WriteSummary writeBatch(std::span<const TraceBuf2View> messages) override;
+    /// @brief Files have no heartbeats so this does nothing.
+    void writeHeartbeat(bool terminate = false) override;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Closes the files.  Additionally, all memory is released.
+    void disconnect() noexcept override;
+    /// @brief Destructor.
+    ~FileRing() override;
+    /// @}
+
+    FileRing& operator=(const FileRing &fileRing) = delete;
+    FileRing(const FileRing &fileRing) = delete;
+private:
+    class FileRingImpl;
+    std::unique_ptr<FileRingImpl> pImpl;
+};
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef DEDUPLICATOR_I_WAVE_RING_HPP
+#define DEDUPLICATOR_I_WAVE_RING_HPP
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <exception>
+namespace Deduplicator
+{
+ class TraceBuf2View;
+ class MessageSlab;
+}
+namespace Deduplicator
+{
+class TerminateException : public std::exception
+{
+private:
+    std::string message;
+public:
+    TerminateException(const std::string &msg) :
+        message(msg)
+    {
+    }
+    // Constructor accepts a const char* that is used to set
+    // the exception message
+    TerminateException(const char* msg)
+        : message(msg)
+    {
+    }
+    // Override the what() method to return our message
+    const char* what() const throw()
+    {
+        return message.c_str();
+    }
+};
+
+/// @brief Summarizes the outcome of writing a batch of messages to a ring.
+struct WriteSummary
+{
+    /// @result The number of messages per second that were put onto the
+    ///         ring.
+    [[nodiscard]] double getWriteRate() const noexcept
+    {
+        if (duration.count() <= 0){return 0;}
+        return nWritten/(duration.count()*1.e-6);
+    }
+    /// @result The fraction of messages in [0,1] that could not be put
+    ///         onto the ring.
+    [[nodiscard]] double getFailureRate() const noexcept
+    {
+        auto nMessages = nWritten + nFailed;
+        if (nMessages == 0){return 0;}
+        return static_cast<double> (nFailed)/nMessages;
+    }
+    /// The number of messages put onto the ring.
+    int nWritten{0};
+    /// The number of messages that could not be put onto the ring.
+    int nFailed{0};
+    /// The time spent writing the batch.
+    std::chrono::microseconds duration{0};
+};
+
+/// @class IWaveRing "iWaveRing.hpp" "deduplicator/iWaveRing.hpp"
+/// @brief The transport the deduplicator reads packets from and writes
+///        packets to.  The \c WaveRing is an Earthworm shared memory ring
+///        and the \c FileRing replays recorded data.  The transport also
+///        owns the clock so a replay can run on its own time.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class IWaveRing
+{
+public:
+    /// @name Connection
+    /// @{
+
+    /// @result True indicates that the transport is ready to use.
+    [[nodiscard]] virtual bool isConnected() const noexcept = 0;
+    /// @result The name of the ring or file.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    [[nodiscard]] virtual std::string getRingName() const = 0;
+    /// @result The current time in microseconds from the epoch.  Packets
+    ///         read from this transport should be judged against this time.
+    [[nodiscard]] virtual std::chrono::microseconds getNow() const noexcept = 0;
+    /// @}
+
+    /// @name Time Window
+    /// @{
+
+    /// @brief Rejects traceBuf2 messages that are expired or in the future
+    ///        while reading.
+    /// @param[in] maximumPastTime    Messages that start before now minus
+    ///                               this are expired.
+    /// @param[in] maximumFutureTime  Messages that end after now plus this
+    ///                               are in the future.
+    /// @throws std::invalid_argument if either time is negative.
+    virtual void setTimeWindow(const std::chrono::seconds &maximumPastTime,
+                               const std::chrono::seconds &maximumFutureTime) = 0;
+    /// @result True indicates the time window was set.
+    [[nodiscard]] virtual bool haveTimeWindow() const noexcept = 0;
+    /// @result The sorted names of the channels that had expired messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] virtual std::vector<std::string> getExpiredChannels() const = 0;
+    /// @result The sorted names of the channels that had future messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] virtual std::vector<std::string> getFutureChannels() const = 0;
+    /// @brief Resets the expired and future channel lists.
+    virtual void clearRejectedChannels() noexcept = 0;
+    /// @}
+
+    /// @name Reading
+    /// @{
+
+    /// @brief Discards the messages waiting to be read.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    virtual void flush() = 0;
+    /// @brief Reads the waiting messages.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    /// @throws TerminateException if there is nothing more to read.
+    virtual void read() = 0;
+    /// @brief Reads the waiting messages into the caller's storage.
+    /// @param[in,out] messageSlab     On input, a slab whose memory will be
+    ///                                reused.  On exit, the raw messages.
+    /// @param[out] traceBuf2Views     Views of the traceBuf2 messages in
+    ///                                messageSlab.
+    /// @throws std::invalid_argument if either pointer is NULL.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    /// @throws TerminateException if there is nothing more to read.
+    virtual void read(MessageSlab *messageSlab,
+                      std::vector<TraceBuf2View> *traceBuf2Views) = 0;
+    /// @result Views of the traceBuf2 messages from the last \c read().
+    [[nodiscard]] virtual const std::vector<TraceBuf2View> &getTraceBuf2ViewsReference() const noexcept = 0;
+    /// @}
+
+    /// @name Writing
+    /// @{
+
+    /// @brief Writes a view of a traceBuf2 message.
+    /// @throws std::runtime_error if \c isConnected() is false or the
+    ///         message could not be written.
+    virtual void write(const TraceBuf2View &message) = 0;
+    /// @brief Writes a batch of traceBuf2 messages.
+    /// @result The number of messages that were and were not written.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    [[nodiscard]] virtual WriteSummary writeBatch(std::span<const TraceBuf2View> messages) = 0;
+    /// @brief Writes a heartbeat.
+    /// @param[in] terminate  True indicates this is the last heartbeat.
+    virtual void writeHeartbeat(bool terminate = false) = 0;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Disconnects and releases all memory.
+    virtual void disconnect() noexcept = 0;
+    /// @brief Destructor.
+    virtual ~IWaveRing() = default;
+    /// @}
+};
+}
+#endif
@@ -0,0 +1,85 @@
+#ifndef DEDUPLICATOR_MESSAGE_SLAB_HPP
+#define DEDUPLICATOR_MESSAGE_SLAB_HPP
+#include <vector>
+#include <span>
+#include <cstddef>
+namespace Deduplicator
+{
+/// @class MessageSlab "messageSlab.hpp" "deduplicator/messageSlab.hpp"
+/// @brief A contiguous arena of raw messages read off of an Earthworm ring.
+///        Each message occupies exactly its length in bytes and is located
+///        through an offset table.  The memory is retained between calls to
+///        \c clear() so that, once the slab has grown to fit a typical ring
+///        scrape, no further allocations are required.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class MessageSlab
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    MessageSlab() = default;
+    /// @}
+
+    /// @name Writing
+    /// @{
+
+    /// @brief Reserves space in the arena.
+    /// @param[in] nBytes     The number of bytes to reserve.
+    /// @param[in] nMessages  The number of messages to reserve.
+    void reserve(size_t nBytes, int nMessages);
+    /// @brief Provides writable space at the end of the arena for the next
+    ///        message.  This is intended to be handed to tport_copyfrom.
+    /// @param[in] maximumLength  The maximum number of bytes that will be
+    ///                           written.
+    /// @result A pointer to at least maximumLength writable bytes.  This
+    ///         pointer is invalidated by the next call to
+    ///         \c beginMessage() or \c reserve().
+    [[nodiscard]] char *beginMessage(size_t maximumLength);
+    /// @brief Commits the message most recently written to the pointer
+    ///        returned by \c beginMessage().
+    /// @param[in] length  The number of bytes actually written.
+    /// @param[in] type    The Earthworm message type.
+    /// @throws std::invalid_argument if length exceeds the space that was
+    ///         requested in \c beginMessage().
+    void commitMessage(size_t length, unsigned char type);
+    /// @}
+
+    /// @name Reading
+    /// @{
+
+    /// @result The number of messages in the arena.
+    [[nodiscard]] int size() const noexcept;
+    /// @result True indicates there are no messages in the arena.
+    [[nodiscard]] bool empty() const noexcept;
+    /// @param[in] index  The message index.  This must be in the range
+    ///                   [0, \c size()).
+    /// @result The bytes of the index'th message.
+    [[nodiscard]] std::span<const char> getMessage(int index) const noexcept;
+    /// @param[in] index  The message index.  This must be in the range
+    ///                   [0, \c size()).
+    /// @result The Earthworm message type of the index'th message.
+    [[nodiscard]] unsigned char getMessageType(int index) const noexcept;
+    /// @result The number of bytes occupied by the messages.
+    [[nodiscard]] size_t getNumberOfBytes() const noexcept;
+    /// @result The number of bytes allocated by the arena.
+    [[nodiscard]] size_t getCapacity() const noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Removes all messages but retains the memory.
+    void clear() noexcept;
+    /// @brief Removes all messages and releases the memory.
+    void release() noexcept;
+    /// @}
+private:
+    std::vector<char> mBuffer;
+    std::vector<size_t> mOffsets{0};
+    std::vector<unsigned char> mTypes;
+    size_t mPending{0};
+};
+}
+#endif
@@ -0,0 +1,114 @@
+#ifndef DEDUPLICATOR_PACKET_BATCH_HPP
+#define DEDUPLICATOR_PACKET_BATCH_HPP
+#include <vector>
+#include <span>
+#include <chrono>
+#include <cstdint>
+namespace Deduplicator
+{
+ class TraceBuf2View;
+ class ChannelInterner;
+}
+namespace Deduplicator
+{
+/// @class PacketBatch "packetBatch.hpp" "deduplicator/packetBatch.hpp"
+/// @brief The header fields of a ring scrape stored as a struct of arrays.
+///        Unpacking every header once lets the expired and future checks
+///        run over contiguous start and end times rather than one packet at
+///        a time.  The times are converted to integer microseconds once,
+///        when the header is unpacked, so the checks and everything after
+///        them are exact.  Like the \c MessageSlab, the memory is retained
+///        between calls to \c set() so a steady stream of scrapes does not
+///        allocate.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class PacketBatch
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    PacketBatch() = default;
+    /// @}
+
+    /// @name Unpacking
+    /// @{
+
+    /// @brief Unpacks the packets' headers.
+    /// @param[in] packets       The packets to unpack.
+    /// @param[in,out] channels  If not NULL then each packet's channel is
+    ///                          interned and its identifier is set.
+    ///                          Otherwise, the identifiers are -1.
+    /// @note A packet without a message, with no samples, without a positive
+    ///       sampling rate, or with an unrepresentable time is marked
+    ///       invalid.
+    void set(std::span<const TraceBuf2View> packets,
+             ChannelInterner *channels);
+    /// @brief Computes the expired and future masks.
+    /// @param[in] earliestTime  Packets that start before this time in
+    ///                          microseconds from the epoch are expired.
+    /// @param[in] latestTime    Packets that end after this time in
+    ///                          microseconds from the epoch are in the
+    ///                          future.
+    /// @param[in] vectorize     If true then the masks are computed with
+    ///                          AVX2 when the processor supports it.
+    ///                          Otherwise, the scalar loop is used.
+    void computeTimeMasks(const std::chrono::microseconds &earliestTime,
+                          const std::chrono::microseconds &latestTime,
+                          bool vectorize = true) noexcept;
+    /// @result True indicates this processor supports the AVX2 path of
+    ///         \c computeTimeMasks().
+    [[nodiscard]] static bool haveAVX2() noexcept;
+    /// @}
+
+    /// @name Fields
+    /// @{
+
+    /// @result The number of packets.
+    [[nodiscard]] int size() const noexcept;
+    /// @result True indicates there are no packets.
+    [[nodiscard]] bool empty() const noexcept;
+    /// @result The packets' start times in microseconds from the epoch.
+    [[nodiscard]] std::span<const int64_t> getStartTimes() const noexcept;
+    /// @result The packets' end times in microseconds from the epoch.  For
+    ///         invalid packets this is the start time.
+    [[nodiscard]] std::span<const int64_t> getEndTimes() const noexcept;
+    /// @result The packets' sampling rates in Hz.
+    [[nodiscard]] std::span<const double> getSamplingRates() const noexcept;
+    /// @result The packets' number of samples.
+    [[nodiscard]] std::span<const int> getNumberOfSamples() const noexcept;
+    /// @result The packets' channel identifiers.
+    [[nodiscard]] std::span<const int> getChannelIdentifiers() const noexcept;
+    /// @}
+
+    /// @name Masks
+    /// @{
+
+    /// @result 1 indicates the packet's header could be unpacked.
+    [[nodiscard]] std::span<const uint8_t> getValidMask() const noexcept;
+    /// @result 1 indicates the packet is expired.
+    /// @note This is set by \c computeTimeMasks().
+    [[nodiscard]] std::span<const uint8_t> getExpiredMask() const noexcept;
+    /// @result 1 indicates the packet is in the future.
+    /// @note This is set by \c computeTimeMasks().
+    [[nodiscard]] std::span<const uint8_t> getFutureMask() const noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Removes all packets but retains the memory.
+    void clear() noexcept;
+    /// @}
+private:
+    std::vector<int64_t> mStartTimes;
+    std::vector<int64_t> mEndTimes;
+    std::vector<double> mSamplingRates;
+    std::vector<int> mNumberOfSamples;
+    std::vector<int> mChannelIdentifiers;
+    std::vector<uint8_t> mValid;
+    std::vector<uint8_t> mExpired;
+    std::vector<uint8_t> mFuture;
+};
+}
+#endif
@@ -0,0 +1,195 @@
+#ifndef DEDUPLICATOR_PIPELINE_HPP
+#define DEDUPLICATOR_PIPELINE_HPP
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+namespace Deduplicator
+{
+ class IWaveRing;
+ class ShardedEngine;
+ class PollingStrategy;
+ struct WriteSummary;
+}
+namespace Deduplicator
+{
+/// @class Pipeline "pipeline.hpp" "deduplicator/pipeline.hpp"
+/// @brief Runs the deduplicator as three stages on separate threads:
+///        (1) a reader for each input ring,
+///        (2) the deduplication engine, which may itself fan each batch
+///            out to several shards, and
+///        (3) a writer that puts the accepted packets onto the output ring.
+///        The stages exchange handles to preallocated batches through
+///        bounded lock-free single-producer single-consumer queues and the
+///        writer returns each batch to the reader once it is written.
+///        Hence, a slow write no longer delays the next read of the input
+///        ring.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class Pipeline
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    Pipeline();
+    /// @}
+
+    /// @name Initialization
+    /// @{
+
+    /// @brief Initializes the pipeline.
+    /// @param[in,out] inputRing   The connected ring from which to read.
+    ///                            This may be a \c WaveRing or a
+    ///                            \c FileRing.  On exit, inputRing is NULL.
+    /// @param[in,out] outputRing  The connected ring to which to write.
+    ///                            On exit, outputRing is NULL.
+    /// @param[in,out] engine      The deduplication engine.  On exit,
+    ///                            engine's behavior is undefined.
+    /// @throws std::invalid_argument if either ring is NULL or not
+    ///         connected.
+    /// @throws std::runtime_error if the pipeline is running.
+    void initialize(std::unique_ptr<IWaveRing> &&inputRing,
+                    std::unique_ptr<IWaveRing> &&outputRing,
+                    ShardedEngine &&engine);
+    /// @brief Initializes the pipeline with several input rings, e.g., one
+    ///        for each redundant telemetry path.  Each ring is read on its
+    ///        own thread and every ring feeds the same engine.
+    /// @param[in,out] inputRings  The connected rings from which to read.
+    ///                            On exit, inputRings is empty.
+    /// @param[in,out] outputRing  The connected ring to which to write.
+    ///                            On exit, outputRing is NULL.
+    /// @param[in,out] engine      The deduplication engine.  On exit,
+    ///                            engine's behavior is undefined.
+    /// @throws std::invalid_argument if inputRings is empty or any ring is
+    ///         NULL or not connected.
+    /// @throws std::runtime_error if the pipeline is running.
+    void initialize(std::vector<std::unique_ptr<IWaveRing>> &&inputRings,
+                    std::unique_ptr<IWaveRing> &&outputRing,
+                    ShardedEngine &&engine);
+    /// @result True indicates the pipeline is initialized.
+    [[nodiscard]] bool isInitialized() const noexcept;
+    /// @brief Sets the number of batches that can be in flight for each
+    ///        input ring.  Each batch holds one scrape of the ring.
+    /// @param[in] nBatches  The number of batches.
+    /// @throws std::invalid_argument if this is not positive.
+    /// @throws std::runtime_error if the pipeline is running.
+    void setNumberOfBatches(int nBatches);
+    /// @result The number of batches.  By default this is 8.
+    [[nodiscard]] int getNumberOfBatches() const noexcept;
+    /// @brief Pins the reader threads to CPUs.
+    /// @param[in] cpus  The i'th reader is pinned to cpus[i].  If this is
+    ///                  negative or there is no i'th CPU then the reader is
+    ///                  not pinned.
+    void setReaderCPUs(const std::vector<int> &cpus);
+    /// @brief Pins the engine thread to a CPU.
+    /// @param[in] cpu  The CPU.  If this is negative then the thread is not
+    ///                 pinned.
+    void setEngineCPU(int cpu) noexcept;
+    /// @brief Pins the writer thread to a CPU.
+    /// @param[in] cpu  The CPU.  If this is negative then the thread is not
+    ///                 pinned.
+    void setWriterCPU(int cpu) noexcept;
+    /// @brief Sets the interval at which the writer heartbeats.
+    void setHeartbeatInterval(const std::chrono::seconds &interval) noexcept;
+    /// @brief Sets the interval at which the engine logs the channels with
+    ///        bad data.  If this is negative then nothing is logged.
+    /// @note Readers whose ring has a time window log the channels their
+    ///       ring rejected on this interval as well.
+    void setLogBadDataInterval(const std::chrono::seconds &interval) noexcept;
+    /// @brief The engine thread checkpoints the engine to a snapshot at
+    ///        this interval and when it exits.
+    /// @param[in] fileName  The snapshot file.  If this is empty then no
+    ///                      snapshots are saved.
+    /// @param[in] interval  The checkpoint interval.
+    /// @throws std::runtime_error if the pipeline is running.
+    /// @sa ShardedEngine::saveSnapshot()
+    void setSnapshot(const std::filesystem::path &fileName,
+                     const std::chrono::seconds &interval);
+    /// @brief Sets how the readers poll the input rings.
+    /// @param[in] strategy  The polling strategy.
+    /// @throws std::runtime_error if the pipeline is running.
+    void setPollingStrategy(const PollingStrategy &strategy);
+    /// @}
+
+    /// @name Running
+    /// @{
+
+    /// @brief Starts the reader, engine, and writer threads.
+    /// @throws std::runtime_error if the pipeline is not initialized or is
+    ///         already running.
+    void start();
+    /// @result True indicates the pipeline is running.  This becomes false
+    ///         after the input ring is terminated and the writer has
+    ///         drained every batch.
+    [[nodiscard]] bool isRunning() const noexcept;
+    /// @brief Stops the threads.  Batches that were read are still
+    ///        processed and written.
+    void stop();
+    /// @}
+
+    /// @name Queue Depths
+    /// @{
+
+    /// @result The number of batches waiting for the engine.
+    [[nodiscard]] int getEngineQueueDepth() const noexcept;
+    /// @result The number of batches waiting for the writer.
+    [[nodiscard]] int getWriterQueueDepth() const noexcept;
+    /// @result The largest number of batches that waited for the engine
+    ///         since the last call to \c resetMaximumQueueDepths().
+    [[nodiscard]] int getMaximumEngineQueueDepth() const noexcept;
+    /// @result The largest number of batches that waited for the writer
+    ///         since the last call to \c resetMaximumQueueDepths().
+    [[nodiscard]] int getMaximumWriterQueueDepth() const noexcept;
+    /// @result The number of times a reader had no free batch and had to
+    ///         wait for the writer since the last call to
+    ///         \c resetMaximumQueueDepths().
+    [[nodiscard]] int getNumberOfReaderStalls() const noexcept;
+    /// @brief Resets the maximum queue depths and reader stalls.
+    void resetMaximumQueueDepths() noexcept;
+    /// @}
+
+    /// @name Latency
+    /// @{
+
+    /// @result The largest latency added to a packet since the last call to
+    ///         \c resetAddedLatency().  This is measured from the end of the
+    ///         scrape preceding the packet's scrape to when the packet's
+    ///         batch was written, i.e., the worst case for a packet that
+    ///         landed on the ring just after a scrape.
+    [[nodiscard]] std::chrono::microseconds getMaximumAddedLatency() const noexcept;
+    /// @result The mean added latency per batch since the last call to
+    ///         \c resetAddedLatency().
+    [[nodiscard]] std::chrono::microseconds getMeanAddedLatency() const noexcept;
+    /// @brief Resets the added latency statistics.
+    void resetAddedLatency() noexcept;
+    /// @}
+
+    /// @name Writing
+    /// @{
+
+    /// @result The number of packets the writer did and did not put onto
+    ///         the output ring, and the time it spent doing so, since the
+    ///         last call to \c resetWriteSummary().
+    [[nodiscard]] WriteSummary getWriteSummary() const noexcept;
+    /// @brief Resets the write summary.
+    void resetWriteSummary() noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Destructor.  This stops the pipeline.
+    ~Pipeline();
+    /// @}
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline(Pipeline &&) noexcept = delete;
+    Pipeline& operator=(const Pipeline &) = delete;
+    Pipeline& operator=(Pipeline &&) noexcept = delete;
+private:
+    class PipelineImpl;
+    std::unique_ptr<PipelineImpl> pImpl;
+};
+}
+#endif
@@ -0,0 +1,76 @@
+#ifndef DEDUPLICATOR_POLLING_STRATEGY_HPP
+#define DEDUPLICATOR_POLLING_STRATEGY_HPP
+#include <chrono>
+namespace Deduplicator
+{
+/// @class PollingStrategy "pollingStrategy.hpp" "deduplicator/pollingStrategy.hpp"
+/// @brief Decides how long to wait between polls of the input ring.  Every
+///        microsecond spent waiting is added to the latency of a packet that
+///        lands on the ring just after a poll, so the wait is bounded by
+///        the maximum added latency.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class PollingStrategy
+{
+public:
+    /// @brief The polling modes.
+    enum class Mode
+    {
+        BusySpin,     /*!< Never wait.  This burns a core but adds no
+                           latency. */
+        Backoff,      /*!< Wait the minimum wait after an empty poll then
+                           double the wait after each subsequent empty poll
+                           up to the maximum added latency.  Any traffic
+                           resets the wait. */
+        LatencyTarget /*!< Poll once every maximum added latency.  The time
+                           spent processing the previous poll is subtracted
+                           from the wait. */
+    };
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    PollingStrategy() = default;
+    /// @}
+
+    /// @name Parameters
+    /// @{
+
+    /// @param[in] mode  The polling mode.
+    void setMode(Mode mode) noexcept;
+    /// @result The polling mode.  By default this is backoff.
+    [[nodiscard]] Mode getMode() const noexcept;
+    /// @param[in] latency  The most latency the wait may add to a packet.
+    /// @throws std::invalid_argument if this is negative.
+    void setMaximumAddedLatency(const std::chrono::microseconds &latency);
+    /// @result The maximum added latency.  By default this is 50 ms.
+    [[nodiscard]] std::chrono::microseconds getMaximumAddedLatency() const noexcept;
+    /// @param[in] wait  The first wait after traffic stops in backoff mode.
+    /// @throws std::invalid_argument if this is not positive.
+    void setMinimumWait(const std::chrono::microseconds &wait);
+    /// @result The minimum wait.  By default this is 10 microseconds.
+    [[nodiscard]] std::chrono::microseconds getMinimumWait() const noexcept;
+    /// @}
+
+    /// @name Polling
+    /// @{
+
+    /// @param[in] haveTraffic     True indicates the previous poll found
+    ///                            messages.
+    /// @param[in] pollDuration    The time spent reading and processing the
+    ///                            previous poll.
+    /// @result The time to wait before the next poll.
+    [[nodiscard]] std::chrono::microseconds computeWait(bool haveTraffic, const std::chrono::microseconds &pollDuration) noexcept;
+    /// @brief Waits for \c computeWait().
+    void wait(bool haveTraffic, const std::chrono::microseconds &pollDuration);
+    /// @brief Resets the backoff.
+    void reset() noexcept;
+    /// @}
+private:
+    std::chrono::microseconds mMaximumAddedLatency{50000};
+    std::chrono::microseconds mMinimumWait{10};
+    std::chrono::microseconds mCurrentWait{0};
+    Mode mMode{Mode::Backoff};
+};
+}
+#endif
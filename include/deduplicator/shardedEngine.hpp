@@ -0,0 +1,208 @@
+#ifndef DEDUPLICATOR_SHARDED_ENGINE_HPP
+#define DEDUPLICATOR_SHARDED_ENGINE_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <span>
+#include <chrono>
+#include <filesystem>
+#include <cstddef>
+#include <deduplicator/engine.hpp>
+namespace Deduplicator
+{
+ class TraceBuf2View;
+ class ChannelKey;
+}
+namespace Deduplicator
+{
+/// @class ShardedEngine "shardedEngine.hpp" "deduplicator/shardedEngine.hpp"
+/// @brief Channels are independent so this partitions them by their hash
+///        into shards.  Each shard is an \c Engine that is only ever touched
+///        by one thread so there are no locks on the channel histories.  The
+///        calling thread processes the first shard and each remaining shard
+///        has its own worker thread.
+/// @note The decisions are returned in the order of the input packets so
+///       the output order of every channel is unchanged.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class ShardedEngine
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor with a single shard.  This does not start any
+    ///        threads and behaves like an \c Engine.
+    ShardedEngine();
+    /// @brief Constructor.
+    /// @param[in] nShards  The number of shards.  This will start
+    ///                     nShards - 1 worker threads.
+    /// @throws std::invalid_argument if nShards is not positive.
+    explicit ShardedEngine(int nShards);
+    /// @brief Move constructor.
+    /// @param[in,out] engine  The engine from which to initialize this
+    ///                        class.  On exit, engine's behavior is
+    ///                        undefined.
+    ShardedEngine(ShardedEngine &&engine) noexcept;
+    /// @}
+
+    /// @name Operators
+    /// @{
+
+    /// @brief Move assignment.
+    /// @param[in,out] engine  The engine whose memory will be moved to this.
+    ///                        On exit, engine's behavior is undefined.
+    /// @result The memory from engine moved to this.
+    ShardedEngine& operator=(ShardedEngine &&engine) noexcept;
+    /// @}
+
+    /// @name Parameters
+    /// @{
+
+    /// @result The number of shards.
+    [[nodiscard]] int getNumberOfShards() const noexcept;
+    /// @param[in] channelKey  A channel.
+    /// @result The shard that owns this channel.
+    [[nodiscard]] int getShard(const ChannelKey &channelKey) const noexcept;
+    /// @brief Sets the maximum past time on every shard.
+    /// @throws std::invalid_argument if this is negative.
+    /// @sa Engine::setMaximumPastTime()
+    void setMaximumPastTime(const std::chrono::seconds &maximumPastTime);
+    /// @result The maximum past time.
+    [[nodiscard]] std::chrono::seconds getMaximumPastTime() const noexcept;
+    /// @brief Sets the maximum future time on every shard.
+    /// @throws std::invalid_argument if this is negative.
+    /// @sa Engine::setMaximumFutureTime()
+    void setMaximumFutureTime(const std::chrono::seconds &maximumFutureTime);
+    /// @result The maximum future time.
+    [[nodiscard]] std::chrono::seconds getMaximumFutureTime() const noexcept;
+    /// @brief Sets the channel history duration on every shard.
+    /// @throws std::invalid_argument if this is negative.
+    /// @sa Engine::setCircularBufferDuration()
+    void setCircularBufferDuration(const std::chrono::seconds &duration);
+    /// @result The approximate duration of each channel's history.
+    [[nodiscard]] std::chrono::seconds getCircularBufferDuration() const noexcept;
+    /// @}
+
+    /// @name Processing
+    /// @{
+
+    /// @brief Processes a batch of packets.
+    /// @param[in] packets     The packets to process.
+    /// @param[in] now         The current time in microseconds from the
+    ///                        epoch.
+    /// @param[out] decisions  The decision for each packet.  This has
+    ///                        dimension [packets.size()].
+    /// @throws std::invalid_argument if decisions is NULL.
+    void process(std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 std::vector<Decision> *decisions);
+    /// @brief Processes a batch of packets delivered by a given source.
+    /// @param[in] packets     The packets to process.
+    /// @param[in] now         The current time in microseconds from the
+    ///                        epoch.
+    /// @param[in] source      The index of the source that delivered the
+    ///                        packets.
+    /// @param[out] decisions  The decision for each packet.  This has
+    ///                        dimension [packets.size()].
+    /// @throws std::invalid_argument if source is negative or decisions
+    ///         is NULL.
+    void process(std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 int source,
+                 std::vector<Decision> *decisions);
+    /// @brief Seeds each shard with its channels' packets.
+    /// @result The number of packets added to the histories.
+    /// @sa Engine::seed()
+    int seed(std::span<const TraceBuf2View> packets,
+             const std::chrono::microseconds &now);
+    /// @result The number of distinct channels over all shards.
+    [[nodiscard]] int getNumberOfChannels() const noexcept;
+    /// @result The number of channels holding a history over all shards.
+    [[nodiscard]] int getNumberOfActiveChannels() const noexcept;
+    /// @result The approximate number of bytes held by all shards.
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+    /// @}
+
+    /// @name Reaping
+    /// @{
+
+    /// @brief Sets the memory budget.  Each shard receives an equal share.
+    /// @param[in] budget  The memory budget in bytes.  If this is 0 then
+    ///                    there is no budget.
+    /// @sa Engine::setMemoryBudget()
+    void setMemoryBudget(size_t budget) noexcept;
+    /// @result The memory budget in bytes.  By default this is 0.
+    [[nodiscard]] size_t getMemoryBudget() const noexcept;
+    /// @brief Sets how often each shard reaps its channels.
+    /// @sa Engine::setReapInterval()
+    void setReapInterval(const std::chrono::seconds &interval) noexcept;
+    /// @result The reap interval.
+    [[nodiscard]] std::chrono::seconds getReapInterval() const noexcept;
+    /// @brief Reaps every shard.
+    /// @param[in] now  The current time in microseconds from the epoch.
+    /// @result The number of idle channels released and the number of
+    ///         channels released to meet the memory budget.
+    /// @sa Engine::reap()
+    std::pair<int, int> reap(const std::chrono::microseconds &now);
+    /// @}
+
+    /// @name Bad Channels
+    /// @{
+
+    /// @result The sorted names of the channels that had expired data since
+    ///         the last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getExpiredChannels() const;
+    /// @result The sorted names of the channels that had future data since
+    ///         the last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getFutureChannels() const;
+    /// @result The sorted names of the channels that had duplicate data
+    ///         since the last call to \c clearBadChannels().
+    [[nodiscard]] std::vector<std::string> getDuplicateChannels() const;
+    /// @brief Resets the expired, future, and duplicate channel lists.
+    void clearBadChannels() noexcept;
+    /// @}
+
+    /// @name Snapshots
+    /// @{
+
+    /// @brief Checkpoints every shard's channel histories to one file.
+    /// @sa Engine::saveSnapshot()
+    void saveSnapshot(const std::filesystem::path &fileName,
+                      const std::chrono::microseconds &now) const;
+    /// @brief Restores the channel histories from a snapshot.  Each channel
+    ///        goes to the shard that owns it so the number of shards may
+    ///        differ from when the snapshot was saved.
+    /// @result The number of channels restored.
+    /// @sa Engine::loadSnapshot()
+    int loadSnapshot(const std::filesystem::path &fileName,
+                     const std::chrono::microseconds &now);
+    /// @}
+
+    /// @name First Deliveries
+    /// @{
+
+    /// @result The first delivery counts sorted by channel name.
+    /// @sa Engine::getFirstDeliveries()
+    [[nodiscard]] std::vector<std::pair<std::string, std::vector<int>>> getFirstDeliveries() const;
+    /// @brief Resets the first delivery counts.
+    void clearFirstDeliveries() noexcept;
+    /// @}
+
+    /// @name Destructors
+    /// @{
+
+    /// @brief Releases all channel histories but retains the parameters.
+    void clear() noexcept;
+    /// @brief Destructor.  This stops the worker threads.
+    ~ShardedEngine();
+    /// @}
+
+    ShardedEngine(const ShardedEngine &) = delete;
+    ShardedEngine& operator=(const ShardedEngine &) = delete;
+private:
+    class ShardedEngineImpl;
+    std::unique_ptr<ShardedEngineImpl> pImpl;
+};
+}
+#endif
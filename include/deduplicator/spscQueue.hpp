@@ -0,0 +1,125 @@
+#ifndef DEDUPLICATOR_SPSC_QUEUE_HPP
+#define DEDUPLICATOR_SPSC_QUEUE_HPP
+#include <vector>
+#include <atomic>
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+namespace Deduplicator
+{
+/// @class SpscQueue "spscQueue.hpp" "deduplicator/spscQueue.hpp"
+/// @brief A bounded, lock-free, single-producer single-consumer queue.
+///        Exactly one thread may push and exactly one (other) thread may pop.
+///        The producer and consumer indices live on separate cache lines
+///        and each side caches the other's index so that, in the steady
+///        state, a push or pop touches only one shared cache line.
+/// @note This is intended to pass small handles, e.g., pointers, between
+///       pipeline stages.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+template<typename T>
+class SpscQueue
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Creates the queue.
+    /// @param[in] capacity  The minimum number of elements the queue can
+    ///                      hold.  This is rounded up to a power of 2.
+    /// @throws std::invalid_argument if capacity is not positive.
+    explicit SpscQueue(const int capacity)
+    {
+        if (capacity < 1)
+        {
+            throw std::invalid_argument("Capacity = "
+                                      + std::to_string(capacity)
+                                      + " must be positive");
+        }
+        size_t n = 1;
+        while (n < static_cast<size_t> (capacity)){n = 2*n;}
+        mSlots.resize(n);
+        mMask = n - 1;
+    }
+    /// @}
+
+    /// @name Producer
+    /// @{
+
+    /// @brief Attempts to add an element to the back of the queue.
+    /// @param[in,out] value  The element to add.  On success, value's
+    ///                       behavior is undefined.
+    /// @result True indicates the element was added.  False indicates the
+    ///         queue is full.
+    [[nodiscard]] bool tryPush(T &&value)
+    {
+        auto tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHeadCache > mMask)
+        {
+            mHeadCache = mHead.load(std::memory_order_acquire);
+            if (tail - mHeadCache > mMask){return false;}
+        }
+        mSlots[tail & mMask] = std::move(value);
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    /// @}
+
+    /// @name Consumer
+    /// @{
+
+    /// @brief Attempts to remove the element at the front of the queue.
+    /// @param[out] value  The element at the front of the queue.
+    /// @result True indicates an element was removed.  False indicates the
+    ///         queue is empty.
+    [[nodiscard]] bool tryPop(T *value)
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        if (head == mTailCache)
+        {
+            mTailCache = mTail.load(std::memory_order_acquire);
+            if (head == mTailCache){return false;}
+        }
+        *value = std::move(mSlots[head & mMask]);
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    /// @}
+
+    /// @name Properties
+    /// @{
+
+    /// @result The number of elements in the queue.  When called by a thread
+    ///         other than the producer or consumer this is approximate.
+    [[nodiscard]] int size() const noexcept
+    {
+        auto head = mHead.load(std::memory_order_acquire);
+        auto tail = mTail.load(std::memory_order_acquire);
+        return tail > head ? static_cast<int> (tail - head) : 0;
+    }
+    /// @result True indicates the queue is empty.
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+    /// @result The maximum number of elements the queue can hold.
+    [[nodiscard]] int getCapacity() const noexcept
+    {
+        return static_cast<int> (mSlots.size());
+    }
+    /// @}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue& operator=(const SpscQueue &) = delete;
+private:
+    static constexpr size_t CACHE_LINE_SIZE{64};
+    std::vector<T> mSlots;
+    size_t mMask{0};
+    /// Owned by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mHead{0};
+    size_t mTailCache{0};
+    /// Owned by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mTail{0};
+    size_t mHeadCache{0};
+};
+}
+#endif
@@ -0,0 +1,92 @@
+#ifndef DEDUPLICATOR_TRACEBUF2_VIEW_HPP
+#define DEDUPLICATOR_TRACEBUF2_VIEW_HPP
+#include <string_view>
+#include <cstddef>
+namespace Deduplicator
+{
+ class TraceBuf2;
+ class ChannelKey;
+}
+namespace Deduplicator
+{
+/// @class TraceBuf2View "traceBuf2View.hpp" "deduplicator/traceBuf2View.hpp"
+/// @brief A non-owning view of an Earthworm tracebuf2 message.  The 64 byte
+///        header is decoded on demand from the underlying bytes so
+///        constructing, copying, and querying a view never allocates.
+/// @note The view is only valid for the lifetime of the bytes it refers to.
+///       For messages read from a ring that is until the next read.
+/// @copyright Ben Baker (University of Utah) distributed under the MIT license.
+class TraceBuf2View
+{
+public:
+    /// @name Constructors
+    /// @{
+
+    /// @brief Constructor.
+    TraceBuf2View() = default;
+    /// @brief Creates a view of a tracebuf2 message.
+    /// @param[in] message        The earthworm message.
+    /// @param[in] messageLength  The length of the message in bytes.
+    /// @throws std::invalid_argument if the message is NULL, the length
+    ///         cannot hold a header or exceeds the maximum tracebuf2 size,
+    ///         or the data type is not supported.
+    TraceBuf2View(const char *message, size_t messageLength);
+    /// @}
+
+    /// @name Trace Header Information
+    /// @{
+
+    /// @result The pin number.
+    [[nodiscard]] int getPinNumber() const noexcept;
+    /// @result The number of samples.
+    [[nodiscard]] int getNumberOfSamples() const noexcept;
+    /// @result The UTC time of the first sample in seconds from the epoch.
+    [[nodiscard]] double getStartTime() const noexcept;
+    /// @result The UTC time of the last sample in seconds from the epoch.
+    /// @throws std::runtime_error if \c haveSamplingRate() is false or
+    ///         \c getNumberOfSamples() is zero.
+    [[nodiscard]] double getEndTime() const;
+    /// @result The sampling rate in Hz.
+    /// @throws std::runtime_error if \c haveSamplingRate() is false.
+    [[nodiscard]] double getSamplingRate() const;
+    /// @result True indicates that the sampling rate is positive.
+    [[nodiscard]] bool haveSamplingRate() const noexcept;
+    /// @result The network code.
+    [[nodiscard]] std::string_view getNetwork() const noexcept;
+    /// @result The station name.
+    [[nodiscard]] std::string_view getStation() const noexcept;
+    /// @result The channel name.
+    [[nodiscard]] std::string_view getChannel() const noexcept;
+    /// @result The location code.
+    [[nodiscard]] std::string_view getLocationCode() const noexcept;
+    /// @result The packed network, station, channel, and location code.
+    ///         This is empty if there is no message.
+    [[nodiscard]] ChannelKey getChannelKey() const noexcept;
+    /// @result The version.
+    [[nodiscard]] std::string_view getVersion() const noexcept;
+    /// @result The data type, e.g., i4 or t8.
+    [[nodiscard]] std::string_view getDataType() const noexcept;
+    /// @result The quality.
+    [[nodiscard]] int getQuality() const noexcept;
+    /// @}
+
+    /// @name Message
+    /// @{
+
+    /// @result True indicates this view refers to a message.
+    [[nodiscard]] bool haveMessage() const noexcept;
+    /// @result A pointer to the native packet.  This has length
+    ///         \c getMessageLength().
+    [[nodiscard]] const char *getNativePacketPointer() const noexcept;
+    /// @result The message length in bytes.
+    [[nodiscard]] size_t getMessageLength() const noexcept;
+    /// @result An owning copy of the message.
+    [[nodiscard]] TraceBuf2 toTraceBuf2() const;
+    /// @}
+private:
+    const char *mMessage{nullptr};
+    size_t mMessageLength{0};
+    bool mSwap{false};
+};
+}
+#endif
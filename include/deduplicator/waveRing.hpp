@@ -3,40 +3,24 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <exception>
+#include <span>
+#include <chrono>
+#include <deduplicator/iWaveRing.hpp>
 namespace Deduplicator
 {
  class TraceBuf2;
+ class TraceBuf2View;
+ class MessageSlab;
+ class CaptureRecorder;
 }
 namespace Deduplicator
 {
-class TerminateException : public std::exception
-{ 
-private: 
-    std::string message; 
-public: 
-    TerminateException(const std::string &msg) :
-        message(msg)
-    {
-    }
-    // Constructor accepts a const char* that is used to set 
-    // the exception message 
-    TerminateException(const char* msg) 
-        : message(msg) 
-    { 
-    } 
-    // Override the what() method to return our message 
-    const char* what() const throw() 
-    { 
-        return message.c_str(); 
-    } 
-}; 
-  
 /// @class WaveRing "waveRing.hpp" "deduplicator/waveRing.hpp"
 /// @brief A utility for reading and writing traceBuf2 messages from an
-///        Earthworm wave ring as well as status messages.
+///        Earthworm wave ring as well as status messages.  This is the
+///        shared memory transport.
 /// @copyright Ben Baker (University of Utah) distributed under the MIT license.
-class WaveRing
+class WaveRing : public IWaveRing
 {
 public:
     /// @name Constructors
@@ -76,10 +60,57 @@ public:
     void connect(const std::string &ringName, const std::string &moduleName = "");
     /// @result True indicates that this class is connected to an
     ///         earthworm ring.
-    [[nodiscard]] bool isConnected() const noexcept;
+    [[nodiscard]] bool isConnected() const noexcept override;
     /// @result The name of the ring to which this class is attached.
     /// @throws std::runtime_error if \c isConnected() is false.
-    [[nodiscard]] std::string getRingName() const;
+    [[nodiscard]] std::string getRingName() const override;
+    /// @result The system time in microseconds from the epoch.
+    [[nodiscard]] std::chrono::microseconds getNow() const noexcept override;
+    /// @}
+
+    /// @name Time Window
+    /// @{
+
+    /// @brief Rejects traceBuf2 messages that are expired or in the future
+    ///        while reading.  The decision is made from the header's start
+    ///        time, number of samples, and sampling rate so a rejected
+    ///        message never makes it into the slab or the views.  This is
+    ///        most useful when catching up after an outage.
+    /// @param[in] maximumPastTime    Messages that start before now minus
+    ///                               this are expired.
+    /// @param[in] maximumFutureTime  Messages that end after now plus this
+    ///                               are in the future.
+    /// @throws std::invalid_argument if either time is negative.
+    /// @note This should match the engine so it does not reject anything
+    ///       the engine would have accepted.
+    /// @sa Engine::setMaximumPastTime(), Engine::setMaximumFutureTime()
+    void setTimeWindow(const std::chrono::seconds &maximumPastTime,
+                       const std::chrono::seconds &maximumFutureTime) override;
+    /// @result True indicates the time window was set.
+    [[nodiscard]] bool haveTimeWindow() const noexcept override;
+    /// @result The sorted names of the channels that had expired messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] std::vector<std::string> getExpiredChannels() const override;
+    /// @result The sorted names of the channels that had future messages
+    ///         rejected since the last call to \c clearRejectedChannels().
+    [[nodiscard]] std::vector<std::string> getFutureChannels() const override;
+    /// @brief Resets the expired and future channel lists.
+    void clearRejectedChannels() noexcept override;
+    /// @}
+
+    /// @name Capture
+    /// @{
+
+    /// @brief Records every message read from the ring, before any is
+    ///        rejected, so the traffic can be replayed later.
+    /// @param[in,out] recorder  The recorder.  This should be started.
+    ///                          On exit, recorder is NULL.  If this is
+    ///                          NULL then the current recorder is stopped.
+    /// @note The recorder is stopped when the ring is disconnected.
+    /// @sa FileRing
+    void setCaptureRecorder(std::unique_ptr<CaptureRecorder> &&recorder);
+    /// @result True indicates the ring's messages are being recorded.
+    [[nodiscard]] bool haveCaptureRecorder() const noexcept;
     /// @}
 
     /// @name Reading
@@ -87,39 +118,82 @@ public:
 
     /// @brief Flushes the ring.  This is usually a good thing to do on startup.
     /// @throws std::runtime_error if \c isConnected() is false.
-    void flush();
+    void flush() override;
     /// @brief Reads the ring.
     /// @throws std::runtime_error if \c isConnected() is false.
-    void read();
+    void read() override;
+    /// @brief Reads the ring into the caller's storage.  This allows several
+    ///        scrapes to be in flight at once, e.g., when the reading,
+    ///        deduplication, and writing happen on separate threads.
+    /// @param[in,out] messageSlab     On input, a slab whose memory will be
+    ///                                reused.  On exit, the raw messages
+    ///                                read from the ring.
+    /// @param[out] traceBuf2Views     Views of the traceBuf2 messages in
+    ///                                messageSlab.
+    /// @throws std::invalid_argument if either pointer is NULL.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    /// @throws TerminateException if the ring received a terminate signal.
+    /// @note This does not affect \c getTraceBuf2ViewsReference().
+    void read(MessageSlab *messageSlab,
+              std::vector<TraceBuf2View> *traceBuf2Views) override;
+    /// @brief Writes a traceBuf2 message to the ring.
+    /// @param[in] message  The message to write.
+    /// @throws std::runtime_error if \c isConnected() is false or the
+    ///         message could not be put onto the ring.
     void write(const TraceBuf2 &message);
-    void writeHeartbeat(bool terminate = false);
-    
+    /// @brief Writes a view of a traceBuf2 message to the ring.
+    /// @param[in] message  The message to write.
+    /// @throws std::runtime_error if \c isConnected() is false or the
+    ///         message could not be put onto the ring.
+    void write(const TraceBuf2View &message) override;
+    /// @brief Writes a batch of traceBuf2 messages to the ring.  Each
+    ///        message is put onto the ring directly from the bytes the view
+    ///        refers to so nothing is copied.
+    /// @param[in] messages  The messages to write.
+    /// @result The number of messages that were and were not put onto the
+    ///         ring.  A failed message does not stop the batch.
+    /// @throws std::runtime_error if \c isConnected() is false.
+    [[nodiscard]] WriteSummary writeBatch(std::span<const TraceBuf2View> messages) override;
+    void writeHeartbeat(bool terminate = false) override;
+
+    /// @result Views of the traceBuf2 messages read from the ring.  This
+    ///         is the preferred way to access the messages since it does not
+    ///         copy or allocate.
+    /// @note The views are invalidated by the next call to \c read().
+    [[nodiscard]] const std::vector<TraceBuf2View> &getTraceBuf2ViewsReference() const noexcept override;
+    /// @note The owning traceBuf2 messages below are unpacked from the views
+    ///       on first request after each \c read().  This allocates so
+    ///       these may throw std::bad_alloc.
 
     /// @result The traceBuf2 messages read from the ring.
-    [[nodiscard]] std::vector<TraceBuf2> getTraceBuf2Messages() const noexcept;
+    [[nodiscard]] std::vector<TraceBuf2> getTraceBuf2Messages() const;
     /// @result The number of traceBuf2 messages.
     [[nodiscard]] int getNumberOfTraceBuf2Messages() const noexcept;
     /// @result A pointer to the array of traceBuf2 messages read from the
     ///         ring.  This has dimension [\c getNumberOfTraceBuf2Messages()].
     /// @note This is not recommended for general use.
-    [[nodiscard]] const TraceBuf2 *getTraceBuf2MessagesPointer() const noexcept;
+    [[nodiscard]] const TraceBuf2 *getTraceBuf2MessagesPointer() const;
     /// @result A reference to the array of traceBuf2 messages read from the
     ///         ring.
     /// @note This is not recommended for general use. 
-    [[nodiscard]] const std::vector<TraceBuf2> &getTraceBuf2MessagesReference() const noexcept;
+    [[nodiscard]] const std::vector<TraceBuf2> &getTraceBuf2MessagesReference() const;
     /// @result The traceBuf2 messages read from the ring moved to this.
     /// @note On exit, all read messages will have been moved and 
     ///       \c getNumberOfTraceBuf2Messages() will be 0.
-    [[nodiscard]] std::vector<TraceBuf2> moveTraceBuf2Messages() noexcept;
+    [[nodiscard]] std::vector<TraceBuf2> moveTraceBuf2Messages();
+    /// @result A reference to the raw messages read from the ring.  Each
+    ///         message is exactly as long as what was on the ring.
+    /// @note This is invalidated by the next call to \c read().
+    [[nodiscard]] const MessageSlab &getMessageSlabReference() const noexcept;
     /// @}
 
     /// @name Destructors
     /// @{
 
     /// @brief Disconnects from the ring.  Additionally, all memory is released.
-    void disconnect() noexcept;
+    void disconnect() noexcept override;
     /// @brief Destructor.
-    ~WaveRing(); 
+    ~WaveRing() override;
     /// @}
  
     WaveRing& operator=(const WaveRing &waveRing) = delete;
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <string>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <boost/program_options.hpp>
+#include <deduplicator/fileRing.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/engine.hpp>
+#include <deduplicator/shardedEngine.hpp>
+#include "version.hpp"
+
+namespace
+{
+
+struct ProgramOptions
+{
+    void parseCommandLineOptions(int argc, char *argv[])
+    {
+        boost::program_options::options_description desc(
+R"""(
+The deduplicator-bench replays Earthworm tank files, or captures, through
+the same decoding and deduplication as the deduplicator but without a ring.
+It reports the throughput, the time spent in each stage, and what was
+decided for the packets.  This gives a repeatable performance baseline.
+    deduplicator-bench --file=a.tnk --file=b.tnk
+Allowed options)""");
+        desc.add_options()
+            ("help", "Produces this help message")
+            ("file", boost::program_options::value<std::vector<std::string>> (),
+                     "A tank file or capture.  Files are replayed in order.")
+            ("maxPastTime",
+             boost::program_options::value<int> ()->default_value(1200),
+             "Packets that start this many seconds before now are expired")
+            ("maxFutureTime",
+             boost::program_options::value<int> ()->default_value(0),
+             "Packets that end this many seconds after now are in the future")
+            ("circularBufferDuration",
+             boost::program_options::value<int> ()->default_value(3600),
+             "Seconds of packet history to retain for each channel")
+            ("numberOfEngineThreads",
+             boost::program_options::value<int> ()->default_value(1),
+             "The number of shards to deduplicate with")
+            ("batchSize",
+             boost::program_options::value<int> ()->default_value(1024),
+             "The number of packets in each read")
+            ("rejectWhileReading",
+             "Reject expired and future packets from their headers while reading as the deduplicator does")
+            ("outputFile", boost::program_options::value<std::string> (),
+                           "Write the accepted packets to this tank file")
+            ("version", "Displays the version number");
+        boost::program_options::positional_options_description positional;
+        positional.add("file", -1);
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+            boost::program_options::command_line_parser(argc, argv)
+                .options(desc).positional(positional).run(), vm);
+        boost::program_options::notify(vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc << std::endl;
+            runProgram = false;
+            return;
+        }
+        if (vm.count("version"))
+        {
+            std::cout << Deduplicator::Version::getVersion() << std::endl;
+            runProgram = false;
+            return;
+        }
+        if (!vm.count("file"))
+        {
+            throw std::invalid_argument("No files specified");
+        }
+        for (const auto &file : vm["file"].as<std::vector<std::string>> ())
+        {
+            if (!std::filesystem::exists(file))
+            {
+                throw std::invalid_argument("File " + file
+                                          + " does not exist");
+            }
+            files.push_back(file);
+        }
+        maxPastTime = std::chrono::seconds {vm["maxPastTime"].as<int> ()};
+        maxFutureTime = std::chrono::seconds {vm["maxFutureTime"].as<int> ()};
+        circularBufferDuration
+            = std::chrono::seconds {vm["circularBufferDuration"].as<int> ()};
+        numberOfEngineThreads = vm["numberOfEngineThreads"].as<int> ();
+        if (numberOfEngineThreads < 1)
+        {
+            throw std::invalid_argument(
+                "numberOfEngineThreads must be positive");
+        }
+        batchSize = vm["batchSize"].as<int> ();
+        rejectWhileReading = vm.count("rejectWhileReading") > 0;
+        if (vm.count("outputFile"))
+        {
+            outputFile = vm["outputFile"].as<std::string> ();
+        }
+    }
+    std::vector<std::filesystem::path> files;
+    std::filesystem::path outputFile;
+    std::chrono::seconds maxPastTime{1200};
+    std::chrono::seconds maxFutureTime{0};
+    std::chrono::seconds circularBufferDuration{3600};
+    int numberOfEngineThreads{1};
+    int batchSize{1024};
+    bool rejectWhileReading{false};
+    bool runProgram{true};
+};
+
+using Clock = std::chrono::steady_clock;
+
+double toSeconds(const Clock::duration &duration)
+{
+    return std::chrono::duration<double> (duration).count();
+}
+
+void reportStage(const std::string &name,
+                 const Clock::duration &duration,
+                 const int64_t nPackets)
+{
+    auto seconds = ::toSeconds(duration);
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10)
+              << seconds*1.e3 << " ms";
+    if (seconds > 0 && nPackets > 0)
+    {
+        std::cout << std::setw(14) << std::setprecision(0)
+                  << nPackets/seconds << " packets/s";
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    ProgramOptions options;
+    try
+    {
+        options.parseCommandLineOptions(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!options.runProgram){return EXIT_SUCCESS;}
+    // The library logs through this
+    auto logger = spdlog::stdout_logger_mt("deduplicator");
+    logger->set_level(spdlog::level::warn);
+
+    Deduplicator::FileRing inputRing;
+    Deduplicator::FileRing outputRing;
+    Deduplicator::ShardedEngine engine{options.numberOfEngineThreads};
+    auto openStartTime = Clock::now();
+    try
+    {
+        inputRing.open(options.files);
+        inputRing.setMaximumBatchSize(options.batchSize);
+        if (options.rejectWhileReading)
+        {
+            inputRing.setTimeWindow(options.maxPastTime,
+                                    options.maxFutureTime);
+        }
+        if (!options.outputFile.empty())
+        {
+            outputRing.create(options.outputFile);
+        }
+        engine.setMaximumPastTime(options.maxPastTime);
+        engine.setMaximumFutureTime(options.maxFutureTime);
+        engine.setCircularBufferDuration(options.circularBufferDuration);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto openDuration = Clock::now() - openStartTime;
+
+    // Same as the deduplicator: read, decide, write the accepted packets
+    Clock::duration readDuration{0};
+    Clock::duration processDuration{0};
+    Clock::duration writeDuration{0};
+    std::array<int64_t, 5> counts{0, 0, 0, 0, 0};
+    int64_t nPackets{0};
+    int64_t nBytes{0};
+    int64_t nReads{0};
+    std::vector<Deduplicator::Decision> decisions;
+    std::vector<Deduplicator::TraceBuf2View> acceptedMessages;
+    while (true)
+    {
+        auto readStartTime = Clock::now();
+        try
+        {
+            inputRing.read();
+        }
+        catch (const Deduplicator::TerminateException &e)
+        {
+            break;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        auto processStartTime = Clock::now();
+        readDuration += processStartTime - readStartTime;
+        nReads = nReads + 1;
+        const auto &views = inputRing.getTraceBuf2ViewsReference();
+        engine.process(views, inputRing.getNow(), &decisions);
+        auto writeStartTime = Clock::now();
+        processDuration += writeStartTime - processStartTime;
+        acceptedMessages.clear();
+        for (size_t i = 0; i < views.size(); ++i)
+        {
+            counts.at(static_cast<size_t> (decisions[i])) += 1;
+            nBytes = nBytes + static_cast<int64_t> (views[i].getMessageLength());
+            if (decisions[i] == Deduplicator::Decision::Accept)
+            {
+                acceptedMessages.push_back(views[i]);
+            }
+        }
+        nPackets = nPackets + static_cast<int64_t> (views.size());
+        if (outputRing.isConnected() && !acceptedMessages.empty())
+        {
+            auto summary = outputRing.writeBatch(acceptedMessages);
+            if (summary.nFailed > 0)
+            {
+                std::cerr << "Failed to write " << summary.nFailed
+                          << " packets" << std::endl;
+            }
+        }
+        writeDuration += Clock::now() - writeStartTime;
+    }
+    outputRing.disconnect();
+
+    auto totalDuration = readDuration + processDuration + writeDuration;
+    auto nDropped = inputRing.getNumberOfMessages() - nPackets;
+    std::cout << "Version: " << Deduplicator::Version::getVersion()
+              << std::endl;
+    std::cout << "Files: " << options.files.size()
+              << "; Messages: " << inputRing.getNumberOfMessages()
+              << "; Reads: " << nReads
+              << "; Engine threads: " << options.numberOfEngineThreads
+              << std::endl;
+    std::cout << "Stages:" << std::endl;
+    ::reportStage("open", openDuration, 0);
+    ::reportStage("read", readDuration, nPackets);
+    ::reportStage("process", processDuration, nPackets);
+    if (!options.outputFile.empty())
+    {
+        ::reportStage("write", writeDuration, counts[0]);
+    }
+    ::reportStage("total", totalDuration, nPackets);
+    auto seconds = ::toSeconds(totalDuration);
+    if (seconds > 0)
+    {
+        std::cout << "Throughput: " << std::setprecision(0)
+                  << nPackets/seconds << " packets/s ("
+                  << std::setprecision(1) << nBytes/seconds/1.e6
+                  << " MB/s)" << std::endl;
+    }
+    std::cout << "Decisions:" << std::endl;
+    std::cout << "  accepted   " << counts[0] << std::endl;
+    std::cout << "  duplicate  " << counts[1] << std::endl;
+    std::cout << "  expired    " << counts[2] << std::endl;
+    std::cout << "  future     " << counts[3] << std::endl;
+    std::cout << "  invalid    " << counts[4] << std::endl;
+    if (nDropped > 0)
+    {
+        std::cout << "  dropped while reading " << nDropped
+                  << " (rejected or empty)" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
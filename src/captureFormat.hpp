@@ -0,0 +1,77 @@
+#ifndef DEDUPLICATOR_CAPTURE_FORMAT_HPP
+#define DEDUPLICATOR_CAPTURE_FORMAT_HPP
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "traceBuf2Layout.hpp"
+/// @brief Describes the byte layout of a ring capture.  The file is a 16
+///        byte header followed by a record for each message taken off the
+///        ring.  The numbers are little endian so a capture made on the
+///        production machine can be replayed anywhere.  This is shared by
+///        the recorder and the file ring.
+namespace Deduplicator::CaptureFormat
+{
+// Bytes  0 - 7:  magic
+// Bytes  8 - 11: version (uint32)
+// Bytes 12 - 15: pad
+constexpr std::array<char, 8> MAGIC{'D', 'E', 'D', 'U', 'P', 'C', 'A', 'P'};
+constexpr uint32_t VERSION{1};
+constexpr int FILE_HEADER_SIZE{16};
+// Bytes  0 - 7:  arrival time in microseconds from the epoch (int64)
+// Bytes  8 - 11: message length (uint32)
+// Byte  12:      logo's installation identifier
+// Byte  13:      logo's module identifier
+// Byte  14:      logo's message type
+// Byte  15:      the ring's sequence number for the logo
+// Then the message padded to 8 bytes
+constexpr int ARRIVAL_TIME_OFFSET{0};
+constexpr int LENGTH_OFFSET{8};
+constexpr int INSTALLATION_OFFSET{12};
+constexpr int MODULE_OFFSET{13};
+constexpr int TYPE_OFFSET{14};
+constexpr int SEQUENCE_NUMBER_OFFSET{15};
+constexpr int RECORD_HEADER_SIZE{16};
+/// The extension given to capture files.
+constexpr std::string_view EXTENSION{".dcap"};
+
+/// @result True indicates the numbers must be byte swapped on this machine.
+[[nodiscard]] constexpr bool needsSwap() noexcept
+{
+    return std::endian::native == std::endian::big;
+}
+
+/// @result The number of bytes a record of a message of this length uses.
+[[nodiscard]] constexpr size_t getRecordSize(const size_t length) noexcept
+{
+    return RECORD_HEADER_SIZE + ((length + 7) & ~static_cast<size_t> (7));
+}
+
+/// @brief Writes the file header.
+inline void packFileHeader(char *header) noexcept
+{
+    std::fill(header, header + FILE_HEADER_SIZE, 0);
+    std::copy(MAGIC.begin(), MAGIC.end(), header);
+    TraceBuf2Layout::pack<uint32_t> (VERSION, header + MAGIC.size(),
+                                     needsSwap());
+}
+
+/// @result True indicates the file begins with a capture header.
+[[nodiscard]] inline bool isCapture(const char *file,
+                                    const size_t fileSize) noexcept
+{
+    if (fileSize < static_cast<size_t> (FILE_HEADER_SIZE)){return false;}
+    return std::equal(MAGIC.begin(), MAGIC.end(), file);
+}
+
+/// @result The version of the capture.
+[[nodiscard]] inline uint32_t unpackVersion(const char *header) noexcept
+{
+    return TraceBuf2Layout::unpack<uint32_t> (header + MAGIC.size(),
+                                              needsSwap());
+}
+
+}
+#endif
@@ -0,0 +1,383 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <deduplicator/captureRecorder.hpp>
+#include <deduplicator/spscQueue.hpp>
+#include "captureFormat.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+
+/// How long the writer waits before looking at its queue again.
+constexpr std::chrono::milliseconds WRITER_WAIT{1};
+
+/// A preallocated block of records
+struct Buffer
+{
+    std::vector<char> data;
+    size_t size{0};
+};
+
+std::chrono::microseconds getNow() noexcept
+{
+    return std::chrono::time_point_cast<std::chrono::microseconds>
+           (std::chrono::high_resolution_clock::now()).time_since_epoch();
+}
+
+}
+
+class CaptureRecorder::CaptureRecorderImpl
+{
+public:
+    /// Gives the current buffer to the writer
+    void handOff() noexcept
+    {
+        // The queue can hold every buffer so this cannot fail
+        while (!mFullQueue->tryPush(std::move(mCurrentBuffer)))
+        {
+            std::this_thread::yield();
+        }
+        mCurrentBuffer = nullptr;
+    }
+    /// Starts a new capture file and deletes the oldest
+    void rotate()
+    {
+        if (mFile.is_open()){mFile.close();}
+        auto fileName
+            = mDirectory / (mPrefix + "." + std::to_string(::getNow().count())
+                          + std::string {CaptureFormat::EXTENSION});
+        mFile.open(fileName, std::ios::binary | std::ios::trunc);
+        if (!mFile.is_open())
+        {
+            throw std::runtime_error("Could not create " + fileName.string());
+        }
+        std::array<char, CaptureFormat::FILE_HEADER_SIZE> header;
+        CaptureFormat::packFileHeader(header.data());
+        mFile.write(header.data(), header.size());
+        mFileSize = header.size();
+        mFileNames.push_back(fileName);
+        while (mMaximumNumberOfFiles > 0 &&
+               static_cast<int> (mFileNames.size()) > mMaximumNumberOfFiles)
+        {
+            std::error_code error;
+            std::filesystem::remove(mFileNames.front(), error);
+            mFileNames.pop_front();
+        }
+        spdlog::get("deduplicator")->info("Capturing to "
+                                        + fileName.string());
+    }
+    /// Writes the full buffers
+    void write()
+    {
+        auto logger = spdlog::get("deduplicator");
+        Buffer *buffer{nullptr};
+        while (true)
+        {
+            if (!mFullQueue->tryPop(&buffer))
+            {
+                if (!mKeepRunning.load(std::memory_order_acquire) &&
+                    mFullQueue->empty())
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(WRITER_WAIT);
+                continue;
+            }
+            try
+            {
+                if (!mFile.is_open() ||
+                    mFileSize + buffer->size > mMaximumFileSize)
+                {
+                    rotate();
+                }
+                mFile.write(buffer->data.data(),
+                            static_cast<std::streamsize> (buffer->size));
+                mFile.flush();
+                if (!mFile)
+                {
+                    mFile.clear();
+                    throw std::runtime_error("Failed to write capture");
+                }
+                mFileSize = mFileSize + buffer->size;
+                mBytesWritten.fetch_add(static_cast<int64_t> (buffer->size),
+                                        std::memory_order_relaxed);
+            }
+            catch (const std::exception &e)
+            {
+                logger->error(e.what());
+            }
+            buffer->size = 0;
+            // The queue can hold every buffer so this cannot fail
+            while (!mFreeQueue->tryPush(std::move(buffer)))
+            {
+                std::this_thread::sleep_for(WRITER_WAIT);
+            }
+        }
+        if (mFile.is_open()){mFile.close();}
+    }
+    std::vector<std::unique_ptr<Buffer>> mBuffers;
+    std::unique_ptr<SpscQueue<Buffer *>> mFreeQueue;
+    std::unique_ptr<SpscQueue<Buffer *>> mFullQueue;
+    std::deque<std::filesystem::path> mFileNames;
+    std::filesystem::path mDirectory;
+    std::string mPrefix;
+    std::ofstream mFile;
+    std::thread mWriterThread;
+    /// The buffer the reader is filling and when it started filling it
+    Buffer *mCurrentBuffer{nullptr};
+    std::chrono::steady_clock::time_point mCurrentBufferStartTime;
+    std::chrono::milliseconds mFlushInterval{1000};
+    size_t mMaximumFileSize{256*1024*1024};
+    size_t mBufferSize{4*1024*1024};
+    size_t mFileSize{0};
+    std::atomic<int64_t> mRecorded{0};
+    std::atomic<int64_t> mDropped{0};
+    std::atomic<int64_t> mBytesWritten{0};
+    std::atomic<bool> mKeepRunning{false};
+    int mNumberOfBuffers{8};
+    int mMaximumNumberOfFiles{8};
+    bool mRunning{false};
+};
+
+/// C'tor
+CaptureRecorder::CaptureRecorder() :
+    pImpl(std::make_unique<CaptureRecorderImpl> ())
+{
+}
+
+/// Destructor
+CaptureRecorder::~CaptureRecorder()
+{
+    stop();
+}
+
+/// File size
+void CaptureRecorder::setMaximumFileSize(const size_t fileSize)
+{
+    if (isRunning()){throw std::runtime_error("Recorder is running");}
+    if (fileSize < 1024*1024)
+    {
+        throw std::invalid_argument("File size must be at least 1 MB");
+    }
+    pImpl->mMaximumFileSize = fileSize;
+}
+
+size_t CaptureRecorder::getMaximumFileSize() const noexcept
+{
+    return pImpl->mMaximumFileSize;
+}
+
+/// Number of files
+void CaptureRecorder::setMaximumNumberOfFiles(const int nFiles)
+{
+    if (isRunning()){throw std::runtime_error("Recorder is running");}
+    if (nFiles < 0)
+    {
+        throw std::invalid_argument("Number of files is negative");
+    }
+    pImpl->mMaximumNumberOfFiles = nFiles;
+}
+
+int CaptureRecorder::getMaximumNumberOfFiles() const noexcept
+{
+    return pImpl->mMaximumNumberOfFiles;
+}
+
+/// Buffers
+void CaptureRecorder::setBuffers(const size_t bufferSize, const int nBuffers)
+{
+    if (isRunning()){throw std::runtime_error("Recorder is running");}
+    if (bufferSize < 64*1024)
+    {
+        throw std::invalid_argument("Buffer size must be at least 64 kB");
+    }
+    if (nBuffers < 2)
+    {
+        throw std::invalid_argument("Need at least 2 buffers");
+    }
+    pImpl->mBufferSize = bufferSize;
+    pImpl->mNumberOfBuffers = nBuffers;
+}
+
+size_t CaptureRecorder::getBufferSize() const noexcept
+{
+    return pImpl->mBufferSize;
+}
+
+int CaptureRecorder::getNumberOfBuffers() const noexcept
+{
+    return pImpl->mNumberOfBuffers;
+}
+
+/// Flush interval
+void CaptureRecorder::setFlushInterval(
+    const std::chrono::milliseconds &interval)
+{
+    if (interval.count() < 0)
+    {
+        throw std::invalid_argument("Flush interval is negative");
+    }
+    pImpl->mFlushInterval = interval;
+}
+
+std::chrono::milliseconds CaptureRecorder::getFlushInterval() const noexcept
+{
+    return pImpl->mFlushInterval;
+}
+
+/// Start
+void CaptureRecorder::start(const std::filesystem::path &directory,
+                            const std::string &prefix)
+{
+    if (isRunning()){throw std::runtime_error("Recorder is running");}
+    if (prefix.empty()){throw std::invalid_argument("Prefix is empty");}
+    if (!directory.empty() && !std::filesystem::exists(directory))
+    {
+        std::filesystem::create_directories(directory);
+    }
+    if (!directory.empty() && !std::filesystem::exists(directory))
+    {
+        throw std::runtime_error("Could not create capture directory: "
+                               + directory.string());
+    }
+    pImpl->mDirectory = directory;
+    pImpl->mPrefix = prefix;
+    pImpl->mFileNames.clear();
+    pImpl->mFileSize = 0;
+    // Allocate everything up front so recording does not allocate
+    auto bufferSize = std::min(pImpl->mBufferSize, pImpl->mMaximumFileSize
+                             - CaptureFormat::FILE_HEADER_SIZE);
+    pImpl->mBuffers.clear();
+    pImpl->mFreeQueue
+        = std::make_unique<SpscQueue<Buffer *>> (pImpl->mNumberOfBuffers);
+    pImpl->mFullQueue
+        = std::make_unique<SpscQueue<Buffer *>> (pImpl->mNumberOfBuffers);
+    for (int i = 0; i < pImpl->mNumberOfBuffers; ++i)
+    {
+        auto buffer = std::make_unique<Buffer> ();
+        buffer->data.resize(bufferSize);
+        auto bufferPtr = buffer.get();
+        pImpl->mBuffers.push_back(std::move(buffer));
+        if (!pImpl->mFreeQueue->tryPush(std::move(bufferPtr)))
+        {
+            throw std::runtime_error("Free queue is full");
+        }
+    }
+    pImpl->mCurrentBuffer = nullptr;
+    pImpl->mRecorded.store(0, std::memory_order_relaxed);
+    pImpl->mDropped.store(0, std::memory_order_relaxed);
+    pImpl->mBytesWritten.store(0, std::memory_order_relaxed);
+    pImpl->mKeepRunning.store(true, std::memory_order_release);
+    pImpl->mWriterThread = std::thread(&CaptureRecorderImpl::write,
+                                       pImpl.get());
+    pImpl->mRunning = true;
+}
+
+bool CaptureRecorder::isRunning() const noexcept
+{
+    return pImpl->mRunning;
+}
+
+/// Record
+void CaptureRecorder::record(const char *message, const size_t length,
+                             const unsigned char installation,
+                             const unsigned char module,
+                             const unsigned char type,
+                             const unsigned char sequenceNumber,
+                             const std::chrono::microseconds &arrivalTime) noexcept
+{
+    using namespace CaptureFormat;
+    if (!pImpl->mRunning || message == nullptr){return;}
+    auto recordSize = getRecordSize(length);
+    auto &buffer = pImpl->mCurrentBuffer;
+    if (buffer != nullptr && buffer->size + recordSize > buffer->data.size())
+    {
+        pImpl->handOff();
+    }
+    if (buffer == nullptr)
+    {
+        // Every buffer is waiting on the writer
+        if (!pImpl->mFreeQueue->tryPop(&buffer))
+        {
+            pImpl->mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->size = 0;
+    }
+    if (buffer->size + recordSize > buffer->data.size())
+    {
+        pImpl->mDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (buffer->size == 0)
+    {
+        pImpl->mCurrentBufferStartTime = std::chrono::steady_clock::now();
+    }
+    auto record = buffer->data.data() + buffer->size;
+    TraceBuf2Layout::pack<int64_t> (arrivalTime.count(),
+                                    record + ARRIVAL_TIME_OFFSET,
+                                    needsSwap());
+    TraceBuf2Layout::pack<uint32_t> (static_cast<uint32_t> (length),
+                                     record + LENGTH_OFFSET,
+                                     needsSwap());
+    record[INSTALLATION_OFFSET] = static_cast<char> (installation);
+    record[MODULE_OFFSET] = static_cast<char> (module);
+    record[TYPE_OFFSET] = static_cast<char> (type);
+    record[SEQUENCE_NUMBER_OFFSET] = static_cast<char> (sequenceNumber);
+    std::copy(message, message + length, record + RECORD_HEADER_SIZE);
+    std::fill(record + RECORD_HEADER_SIZE + length, record + recordSize, 0);
+    buffer->size = buffer->size + recordSize;
+    pImpl->mRecorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Flush
+void CaptureRecorder::flush(const bool force) noexcept
+{
+    auto buffer = pImpl->mCurrentBuffer;
+    if (!pImpl->mRunning || buffer == nullptr || buffer->size == 0){return;}
+    if (force ||
+        std::chrono::steady_clock::now() - pImpl->mCurrentBufferStartTime
+        >= pImpl->mFlushInterval)
+    {
+        pImpl->handOff();
+    }
+}
+
+/// Stop
+void CaptureRecorder::stop()
+{
+    if (!pImpl || !pImpl->mRunning){return;}
+    flush(true);
+    pImpl->mKeepRunning.store(false, std::memory_order_release);
+    if (pImpl->mWriterThread.joinable()){pImpl->mWriterThread.join();}
+    pImpl->mRunning = false;
+    spdlog::get("deduplicator")->info("Captured "
+                   + std::to_string(getNumberOfRecordedMessages())
+                   + " messages ("
+                   + std::to_string(getNumberOfDroppedMessages())
+                   + " dropped)");
+}
+
+/// Statistics
+int64_t CaptureRecorder::getNumberOfRecordedMessages() const noexcept
+{
+    return pImpl->mRecorded.load(std::memory_order_relaxed);
+}
+
+int64_t CaptureRecorder::getNumberOfDroppedMessages() const noexcept
+{
+    return pImpl->mDropped.load(std::memory_order_relaxed);
+}
+
+int64_t CaptureRecorder::getNumberOfBytesWritten() const noexcept
+{
+    return pImpl->mBytesWritten.load(std::memory_order_relaxed);
+}
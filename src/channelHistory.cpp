@@ -0,0 +1,273 @@
+#include <string>
+#include <cmath>
+#include <stdexcept>
+#include <cassert>
+#include <deduplicator/channelHistory.hpp>
+
+using namespace Deduplicator;
+
+namespace
+{
+/// Two packets whose start times differ by less than this are the same.
+int64_t toTolerance(const double samplingRate) noexcept
+{
+    if (samplingRate < 105){return 15000;}
+    if (samplingRate < 255){return 4500;}
+    if (samplingRate < 505){return 2500;}
+    if (samplingRate < 1005){return 1500;}
+    return 0;
+}
+/// The smallest buffer.  This is a power of 2.
+constexpr int MINIMUM_CAPACITY{8};
+}
+
+/// C'tor
+ChannelHistory::ChannelHistory(const double samplingRate)
+{
+    if (!(samplingRate > 0))
+    {
+        throw std::invalid_argument("Sampling rate = "
+                                  + std::to_string(samplingRate)
+                                  + " must be positive");
+    }
+    mStartTimes.resize(MINIMUM_CAPACITY, 0);
+    mSamples.resize(MINIMUM_CAPACITY, 0);
+    mTolerance = ::toTolerance(std::round(samplingRate));
+    mSamplingRate = samplingRate;
+}
+
+/// Initialized?
+bool ChannelHistory::isInitialized() const noexcept
+{
+    return mSamplingRate > 0;
+}
+
+/// Sampling rate
+double ChannelHistory::getSamplingRate() const noexcept
+{
+    return mSamplingRate;
+}
+
+/// Tolerance
+std::chrono::microseconds ChannelHistory::getTolerance() const noexcept
+{
+    return std::chrono::microseconds {mTolerance};
+}
+
+/// Capacity
+int ChannelHistory::getCapacity() const noexcept
+{
+    return static_cast<int> (mStartTimes.size());
+}
+
+/// Size
+int ChannelHistory::size() const noexcept
+{
+    return mSize;
+}
+
+bool ChannelHistory::empty() const noexcept
+{
+    return mSize == 0;
+}
+
+/// Memory
+size_t ChannelHistory::getMemoryUsage() const noexcept
+{
+    return sizeof(ChannelHistory)
+         + mStartTimes.capacity()*sizeof(int64_t)
+         + mSamples.capacity()*sizeof(int32_t);
+}
+
+/// Logical to physical index.  The capacity is a power of 2.
+int ChannelHistory::toPhysicalIndex(const int index) const noexcept
+{
+    return (mHead + index) & (getCapacity() - 1);
+}
+
+/// Moves the packets to a new buffer with the oldest packet at the front
+void ChannelHistory::resize(const int capacity)
+{
+#ifndef NDEBUG
+    assert(capacity >= mSize && (capacity & (capacity - 1)) == 0);
+#endif
+    std::vector<int64_t> startTimes(capacity, 0);
+    std::vector<int32_t> samples(capacity, 0);
+    for (int i = 0; i < mSize; ++i)
+    {
+        auto physicalIndex = toPhysicalIndex(i);
+        startTimes[i] = mStartTimes[physicalIndex];
+        samples[i] = mSamples[physicalIndex];
+    }
+    mStartTimes = std::move(startTimes);
+    mSamples = std::move(samples);
+    mHead = 0;
+}
+
+/// Binary search for the first packet starting after the given time
+int ChannelHistory::upperBound(const int64_t startTime) const noexcept
+{
+    int first = 0;
+    int count = mSize;
+    while (count > 0)
+    {
+        auto step = count/2;
+        auto index = first + step;
+        if (mStartTimes[toPhysicalIndex(index)] <= startTime)
+        {
+            first = index + 1;
+            count = count - (step + 1);
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return first;
+}
+
+/// Seen this packet?
+bool ChannelHistory::contains(
+    const std::chrono::microseconds startTime) const noexcept
+{
+    if (mSize == 0 || mTolerance <= 0){return false;}
+    // Find the first packet in (t - tolerance, ...) then see if it is also
+    // in the window (t - tolerance, t + tolerance)
+    auto t = startTime.count();
+    auto index = upperBound(t - mTolerance);
+    if (index == mSize){return false;}
+    return mStartTimes[toPhysicalIndex(index)] < t + mTolerance;
+}
+
+/// Is this packet exactly where we expect the next one to be?
+bool ChannelHistory::isExpectedNext(
+    const std::chrono::microseconds startTime) const noexcept
+{
+    if (mSize == 0 || mTolerance <= 0){return false;}
+    // The second check guarantees nothing already in the history is within
+    // the tolerance.  This matters when packets are shorter than the
+    // tolerance, e.g., a single sample at 100 Hz.
+    auto t = startTime.count();
+    return std::abs(t - mExpectedNextStartTime) < mTolerance
+        && t - mStartTimes[toPhysicalIndex(mSize - 1)] >= mTolerance;
+}
+
+/// Expected next start time
+std::chrono::microseconds
+ChannelHistory::getExpectedNextStartTime() const noexcept
+{
+    return std::chrono::microseconds {mExpectedNextStartTime};
+}
+
+/// Add a packet
+void ChannelHistory::insert(const std::chrono::microseconds startTime,
+                            const int nSamples)
+{
+    if (!isInitialized()){throw std::runtime_error("History not initialized");}
+    // Make room
+    if (mSize == getCapacity()){resize(2*getCapacity());}
+    auto capacity = getCapacity();
+    auto t = startTime.count();
+    // Typically new stuff shows up so this is an append.  The next packet
+    // should then start one sample after this packet ends.
+    if (mSize == 0 || mStartTimes[toPhysicalIndex(mSize - 1)] <= t)
+    {
+        auto physicalIndex = toPhysicalIndex(mSize);
+        mStartTimes[physicalIndex] = t;
+        mSamples[physicalIndex] = nSamples;
+        mSize = mSize + 1;
+        mExpectedNextStartTime
+            = t + static_cast<int64_t> (std::round(nSamples*1.e6
+                                                  /mSamplingRate));
+        return;
+    }
+    // Late packet.  Find where it goes then open a slot by shifting
+    // whichever side of the insertion point has fewer packets.
+    auto index = upperBound(t);
+    if (index < mSize - index)
+    {
+        mHead = (mHead == 0) ? capacity - 1 : mHead - 1;
+        for (int i = 0; i < index; ++i)
+        {
+            auto current = toPhysicalIndex(i);
+            auto next = toPhysicalIndex(i + 1);
+            mStartTimes[current] = mStartTimes[next];
+            mSamples[current] = mSamples[next];
+        }
+    }
+    else
+    {
+        for (int i = mSize; i > index; --i)
+        {
+            auto current = toPhysicalIndex(i);
+            auto previous = toPhysicalIndex(i - 1);
+            mStartTimes[current] = mStartTimes[previous];
+            mSamples[current] = mSamples[previous];
+        }
+    }
+    auto physicalIndex = toPhysicalIndex(index);
+    mStartTimes[physicalIndex] = t;
+    mSamples[physicalIndex] = nSamples;
+    mSize = mSize + 1;
+}
+
+/// Remove old packets
+int ChannelHistory::evict(
+    const std::chrono::microseconds oldestStartTime) noexcept
+{
+    auto t = oldestStartTime.count();
+    int nEvicted = 0;
+    while (mSize > 0 && mStartTimes[mHead] < t)
+    {
+        mHead = toPhysicalIndex(1);
+        mSize = mSize - 1;
+        nEvicted = nEvicted + 1;
+    }
+    // Give back memory once the buffer is mostly empty.  Waiting until it
+    // is a quarter full means a channel near the threshold does not
+    // repeatedly grow and shrink.
+    if (nEvicted > 0 &&
+        getCapacity() > MINIMUM_CAPACITY && 4*mSize <= getCapacity())
+    {
+        auto capacity = getCapacity();
+        while (capacity > MINIMUM_CAPACITY && 4*mSize <= capacity)
+        {
+            capacity = capacity/2;
+        }
+        try
+        {
+            resize(capacity);
+        }
+        catch (...) // Keep the larger buffer
+        {
+        }
+    }
+    return nEvicted;
+}
+
+/// Start time
+std::chrono::microseconds ChannelHistory::getStartTime(
+    const int index) const noexcept
+{
+#ifndef NDEBUG
+    assert(index >= 0 && index < mSize);
+#endif
+    return std::chrono::microseconds {mStartTimes[toPhysicalIndex(index)]};
+}
+
+/// Number of samples
+int ChannelHistory::getNumberOfSamples(const int index) const noexcept
+{
+#ifndef NDEBUG
+    assert(index >= 0 && index < mSize);
+#endif
+    return mSamples[toPhysicalIndex(index)];
+}
+
+/// Reset
+void ChannelHistory::clear() noexcept
+{
+    mExpectedNextStartTime = 0;
+    mHead = 0;
+    mSize = 0;
+}
@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <deduplicator/channelInterner.hpp>
+#include <deduplicator/channelKey.hpp>
+
+using namespace Deduplicator;
+
+namespace
+{
+/// A slot in the open-addressing table.  The hash is kept alongside the
+/// identifier so probing rarely has to touch the key and growing the table
+/// does not rehash.
+struct Slot
+{
+    uint64_t hash{0};
+    int identifier{-1};
+};
+/// The initial table size.  The table is kept at most half full so probe
+/// sequences stay short.
+constexpr size_t INITIAL_CAPACITY{1024};
+}
+
+class ChannelInterner::ChannelInternerImpl
+{
+public:
+    /// Finds the slot holding the key or the empty slot where it belongs
+    size_t probe(const ChannelKey &key, const uint64_t hash) const noexcept
+    {
+        auto mask = mSlots.size() - 1;
+        auto index = static_cast<size_t> (hash) & mask;
+        while (true)
+        {
+            const auto &slot = mSlots[index];
+            if (slot.identifier < 0){return index;}
+            if (slot.hash == hash && mKeys[slot.identifier] == key)
+            {
+                return index;
+            }
+            index = (index + 1) & mask;
+        }
+    }
+    /// Doubles the table
+    void grow()
+    {
+        std::vector<Slot> slots(2*mSlots.size());
+        auto mask = slots.size() - 1;
+        for (const auto &slot : mSlots)
+        {
+            if (slot.identifier < 0){continue;}
+            auto index = static_cast<size_t> (slot.hash) & mask;
+            while (slots[index].identifier >= 0)
+            {
+                index = (index + 1) & mask;
+            }
+            slots[index] = slot;
+        }
+        mSlots = std::move(slots);
+    }
+    /// Empties the table in place.  The grown table is kept so refilling
+    /// it does not reallocate.
+    void clear() noexcept
+    {
+        std::fill(mSlots.begin(), mSlots.end(), Slot {});
+        mKeys.clear();
+    }
+    /// Linear probing table mapping the key to the identifier.  The size
+    /// is a power of 2.
+    std::vector<Slot> mSlots = std::vector<Slot> (INITIAL_CAPACITY);
+    /// Maps the identifier to the key
+    std::vector<ChannelKey> mKeys;
+};
+
+/// C'tor
+ChannelInterner::ChannelInterner() :
+    pImpl(std::make_unique<ChannelInternerImpl> ())
+{
+}
+
+/// Move c'tor
+ChannelInterner::ChannelInterner(ChannelInterner &&interner) noexcept
+{
+    *this = std::move(interner);
+}
+
+/// Move assignment
+ChannelInterner& ChannelInterner::operator=(ChannelInterner &&interner) noexcept
+{
+    if (&interner == this){return *this;}
+    pImpl = std::move(interner.pImpl);
+    return *this;
+}
+
+/// Destructor
+ChannelInterner::~ChannelInterner() = default;
+
+/// Reset class
+void ChannelInterner::clear() noexcept
+{
+    pImpl->clear();
+}
+
+/// Intern
+int ChannelInterner::intern(const ChannelKey &key)
+{
+    auto hash = key.getHash();
+    auto index = pImpl->probe(key, hash);
+    auto identifier = pImpl->mSlots[index].identifier;
+    if (identifier >= 0){return identifier;}
+    // New channel
+    identifier = size();
+    pImpl->mKeys.push_back(key);
+    pImpl->mSlots[index] = Slot {hash, identifier};
+    if (2*pImpl->mKeys.size() > pImpl->mSlots.size()){pImpl->grow();}
+    return identifier;
+}
+
+/// Find
+int ChannelInterner::find(const ChannelKey &key) const noexcept
+{
+    auto index = pImpl->probe(key, key.getHash());
+    return pImpl->mSlots[index].identifier;
+}
+
+/// Size
+int ChannelInterner::size() const noexcept
+{
+    return static_cast<int> (pImpl->mKeys.size());
+}
+
+/// Key
+const ChannelKey &ChannelInterner::getKey(const int identifier) const
+{
+    if (identifier < 0 || identifier >= size())
+    {
+        throw std::invalid_argument("Channel identifier "
+                                  + std::to_string(identifier)
+                                  + " not in range [0,"
+                                  + std::to_string(size()) + ")");
+    }
+    return pImpl->mKeys[identifier];
+}
+
+/// Name
+std::string ChannelInterner::getName(const int identifier) const
+{
+    return getKey(identifier).toName();
+}
@@ -0,0 +1,131 @@
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <deduplicator/channelKey.hpp>
+#include "traceBuf2Layout.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+// Offsets of the fields relative to the station's start in the header
+constexpr int STATION{0};
+constexpr int NETWORK{TraceBuf2Layout::NETWORK_OFFSET
+                    - TraceBuf2Layout::STATION_OFFSET};
+constexpr int CHANNEL{TraceBuf2Layout::CHANNEL_OFFSET
+                    - TraceBuf2Layout::STATION_OFFSET};
+constexpr int LOCATION{TraceBuf2Layout::LOCATION_OFFSET
+                     - TraceBuf2Layout::STATION_OFFSET};
+static_assert(LOCATION + TraceBuf2Layout::LOCATION_WIDTH <= 24,
+              "Key is too small");
+
+/// Copies a field while respecting its width
+void copyField(char *destination, const std::string_view &source,
+               const int width) noexcept
+{
+    auto nCopy = std::min(source.size(), static_cast<size_t> (width - 1));
+    std::copy(source.data(), source.data() + nCopy, destination);
+}
+
+/// Views a field
+std::string_view viewField(const char *field, const int width) noexcept
+{
+    return std::string_view {field,
+                             TraceBuf2Layout::fieldLength(field, width)};
+}
+
+/// Finalizes the hash - this is the MurmurHash3 64-bit finalizer
+uint64_t mix(uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+/// Pack from the header
+ChannelKey ChannelKey::fromHeader(const char *header) noexcept
+{
+    using namespace TraceBuf2Layout;
+    return ChannelKey {viewField(header + NETWORK_OFFSET,  NETWORK_WIDTH),
+                       viewField(header + STATION_OFFSET,  STATION_WIDTH),
+                       viewField(header + CHANNEL_OFFSET,  CHANNEL_WIDTH),
+                       viewField(header + LOCATION_OFFSET, LOCATION_WIDTH)};
+}
+
+/// C'tor
+ChannelKey::ChannelKey(const std::string_view network,
+                       const std::string_view station,
+                       const std::string_view channel,
+                       const std::string_view location) noexcept
+{
+    using namespace TraceBuf2Layout;
+    ::copyField(mBytes.data() + STATION,  station,  STATION_WIDTH);
+    ::copyField(mBytes.data() + NETWORK,  network,  NETWORK_WIDTH);
+    ::copyField(mBytes.data() + CHANNEL,  channel,  CHANNEL_WIDTH);
+    ::copyField(mBytes.data() + LOCATION, location, LOCATION_WIDTH);
+}
+
+/// Codes
+std::string_view ChannelKey::getNetwork() const noexcept
+{
+    return ::viewField(mBytes.data() + NETWORK,
+                       TraceBuf2Layout::NETWORK_WIDTH);
+}
+
+std::string_view ChannelKey::getStation() const noexcept
+{
+    return ::viewField(mBytes.data() + STATION,
+                       TraceBuf2Layout::STATION_WIDTH);
+}
+
+std::string_view ChannelKey::getChannel() const noexcept
+{
+    return ::viewField(mBytes.data() + CHANNEL,
+                       TraceBuf2Layout::CHANNEL_WIDTH);
+}
+
+std::string_view ChannelKey::getLocationCode() const noexcept
+{
+    return ::viewField(mBytes.data() + LOCATION,
+                       TraceBuf2Layout::LOCATION_WIDTH);
+}
+
+/// Name
+std::string ChannelKey::toName() const
+{
+    auto network = getNetwork();
+    auto station = getStation();
+    auto channel = getChannel();
+    auto location = getLocationCode();
+    std::string name;
+    name.reserve(network.size() + station.size() + channel.size()
+               + location.size() + 3);
+    name.append(network);
+    name.append(".");
+    name.append(station);
+    name.append(".");
+    name.append(channel);
+    if (!location.empty())
+    {
+        name.append(".");
+        name.append(location);
+    }
+    return name;
+}
+
+/// Hash
+uint64_t ChannelKey::getHash() const noexcept
+{
+    std::array<uint64_t, 3> words;
+    std::memcpy(words.data(), mBytes.data(), sizeof(words));
+    auto h = words[0]*0x9e3779b97f4a7c15ULL;
+    h ^= std::rotl(words[1]*0xc2b2ae3d27d4eb4fULL, 31);
+    h ^= std::rotl(words[2]*0x165667b19e3779f9ULL, 17);
+    return ::mix(h);
+}
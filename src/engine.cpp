@@ -0,0 +1,554 @@
+#include <string>
+#include <vector>
+#include <set>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <deduplicator/engine.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/channelInterner.hpp>
+#include <deduplicator/channelHistory.hpp>
+#include <deduplicator/packetBatch.hpp>
+#include "snapshot.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+std::vector<std::string> toNames(const std::set<int> &identifiers,
+                                 const ChannelInterner &channels)
+{
+    std::vector<std::string> names;
+    names.reserve(identifiers.size());
+    for (const auto &identifier : identifiers)
+    {
+        names.push_back(channels.getName(identifier));
+    }
+    return names;
+}
+}
+
+class Engine::EngineImpl
+{
+public:
+    /// Unpacks the headers then decides what to do with each packet
+    void process(const std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 const int source,
+                 const bool seeding,
+                 Decision *decisions)
+    {
+        auto earliestTime = now - mMaximumPastTime;
+        auto latestTime = now + mMaximumFutureTime;
+        // Identify the channels straight from the header bytes and check
+        // the whole batch's times at once
+        mPacketBatch.set(packets, &mChannels);
+        mPacketBatch.computeTimeMasks(earliestTime, latestTime);
+        for (int i = 0; i < mPacketBatch.size(); ++i)
+        {
+            decisions[i] = process(i, now, source, seeding);
+        }
+    }
+    /// Decides what to do with the i'th packet of the batch
+    Decision process(const int i,
+                     const std::chrono::microseconds &now,
+                     const int source,
+                     const bool seeding)
+    {
+        auto channelIdentifier = mPacketBatch.getChannelIdentifiers()[i];
+        if (!mPacketBatch.getValidMask()[i]){return Decision::Invalid;}
+        if (mPacketBatch.getExpiredMask()[i])
+        {
+            if (!seeding){mExpiredChannels.insert(channelIdentifier);}
+            return Decision::Expired;
+        }
+        if (mPacketBatch.getFutureMask()[i])
+        {
+            if (!seeding){mFutureChannels.insert(channelIdentifier);}
+            return Decision::Future;
+        }
+        auto samplingRate = mPacketBatch.getSamplingRates()[i];
+        auto nSamples = mPacketBatch.getNumberOfSamples()[i];
+        std::chrono::microseconds packetStartTime
+        {
+            mPacketBatch.getStartTimes()[i]
+        };
+        if (channelIdentifier >= static_cast<int> (mChannelHistories.size()))
+        {
+            mChannelHistories.resize(channelIdentifier + 1);
+            mLastActivity.resize(channelIdentifier + 1);
+        }
+        mLastActivity[channelIdentifier] = now;
+        auto &channelHistory = mChannelHistories[channelIdentifier];
+        if (!channelHistory.isInitialized())
+        {
+            auto logger = spdlog::get("deduplicator");
+            if (logger)
+            {
+                logger->info("Creating new history for: "
+                           + mChannels.getName(channelIdentifier));
+            }
+            channelHistory = ChannelHistory {samplingRate};
+            if (channelHistory.getTolerance().count() == 0 && logger)
+            {
+                logger->critical("Could not classify sampling rate: "
+                               + std::to_string(samplingRate)
+                               + " for "
+                               + mChannels.getName(channelIdentifier));
+            }
+        }
+        if (std::lround(channelHistory.getSamplingRate())
+         != std::lround(samplingRate))
+        {
+            auto logger = spdlog::get("deduplicator");
+            if (logger)
+            {
+                logger->warn("Inconsistent sampling rates for: "
+                           + mChannels.getName(channelIdentifier));
+            }
+        }
+        else if (channelHistory.isExpectedNext(packetStartTime))
+        {
+            // Steady state - this packet continues the channel so it
+            // cannot be a duplicate and we skip the search.
+        }
+        else if (channelHistory.contains(packetStartTime))
+        {
+            if (!seeding){mDuplicateChannels.insert(channelIdentifier);}
+            return Decision::Duplicate;
+        }
+        // Insert it (typically new stuff shows up) after forgetting what
+        // fell out of the history window
+        channelHistory.evict(now - mCircularBufferDuration);
+        channelHistory.insert(packetStartTime, nSamples);
+        if (seeding){return Decision::Accept;}
+        // Credit the source that delivered this first
+        if (channelIdentifier >= static_cast<int> (mFirstDeliveries.size()))
+        {
+            mFirstDeliveries.resize(channelIdentifier + 1);
+        }
+        auto &firstDeliveries = mFirstDeliveries[channelIdentifier];
+        if (source >= static_cast<int> (firstDeliveries.size()))
+        {
+            firstDeliveries.resize(source + 1, 0);
+        }
+        firstDeliveries[source] = firstDeliveries[source] + 1;
+        mNumberOfSources = std::max(mNumberOfSources, source + 1);
+        return Decision::Accept;
+    }
+    /// Reaps the channels if it is time
+    void reapIfNecessary(const std::chrono::microseconds &now)
+    {
+        if (mReapInterval.count() <= 0){return;}
+        if (now - mLastReapTime < mReapInterval){return;}
+        reap(now);
+    }
+    /// The bytes a channel's history holds outside the engine's table
+    static size_t getHistoryMemoryUsage(
+        const ChannelHistory &channelHistory) noexcept
+    {
+        if (!channelHistory.isInitialized()){return 0;}
+        return channelHistory.getMemoryUsage() - sizeof(ChannelHistory);
+    }
+    /// The bytes held by the engine and its channel histories
+    [[nodiscard]] size_t getMemoryUsage() const noexcept
+    {
+        size_t memoryUsage = sizeof(EngineImpl)
+            + mChannelHistories.capacity()*sizeof(ChannelHistory)
+            + mLastActivity.capacity()*sizeof(std::chrono::microseconds);
+        for (const auto &channelHistory : mChannelHistories)
+        {
+            memoryUsage = memoryUsage + getHistoryMemoryUsage(channelHistory);
+        }
+        return memoryUsage;
+    }
+    /// Frees the idle channels then the least recently active channels
+    /// until the memory budget is met
+    std::pair<int, int> reap(const std::chrono::microseconds &now)
+    {
+        mLastReapTime = now;
+        // A packet accepted up to the maximum future time ahead of now only
+        // expires once the maximum past time has passed after its start
+        auto oldestActivity = now - (mMaximumPastTime + mMaximumFutureTime);
+        int nIdle = 0;
+        for (int i = 0; i < static_cast<int> (mChannelHistories.size()); ++i)
+        {
+            if (!mChannelHistories[i].isInitialized()){continue;}
+            // Anything that could be a duplicate of this channel's history
+            // would now be expired
+            if (mLastActivity[i] < oldestActivity)
+            {
+                mChannelHistories[i] = ChannelHistory {};
+                nIdle = nIdle + 1;
+            }
+        }
+        // Measured as Engine::getMemoryUsage() reports it
+        auto memoryUsage = getMemoryUsage();
+        int nEvicted = 0;
+        if (mMemoryBudget > 0 && memoryUsage > mMemoryBudget)
+        {
+            std::vector<std::pair<std::chrono::microseconds, int>> channels;
+            for (int i = 0; i < static_cast<int> (mChannelHistories.size());
+                 ++i)
+            {
+                if (!mChannelHistories[i].isInitialized()){continue;}
+                channels.push_back(std::pair {mLastActivity[i], i});
+            }
+            std::sort(channels.begin(), channels.end());
+            for (const auto &channel : channels)
+            {
+                if (memoryUsage <= mMemoryBudget){break;}
+                auto &channelHistory = mChannelHistories[channel.second];
+                memoryUsage = memoryUsage
+                            - getHistoryMemoryUsage(channelHistory);
+                channelHistory = ChannelHistory {};
+                nEvicted = nEvicted + 1;
+            }
+        }
+        auto logger = spdlog::get("deduplicator");
+        if (logger)
+        {
+            if (nIdle > 0)
+            {
+                logger->info("Released " + std::to_string(nIdle)
+                           + " idle channels");
+            }
+            if (nEvicted > 0)
+            {
+                logger->warn("Released " + std::to_string(nEvicted)
+                           + " least recently active channels to meet the "
+                           + "memory budget");
+            }
+        }
+        return std::pair {nIdle, nEvicted};
+    }
+    ChannelInterner mChannels;
+    /// The headers of the batch being processed
+    PacketBatch mPacketBatch;
+    std::vector<ChannelHistory> mChannelHistories;
+    /// The last time each channel had a packet
+    std::vector<std::chrono::microseconds> mLastActivity;
+    std::set<int> mExpiredChannels;
+    std::set<int> mFutureChannels;
+    std::set<int> mDuplicateChannels;
+    /// The number of packets each source delivered first for each channel
+    std::vector<std::vector<int>> mFirstDeliveries;
+    std::chrono::seconds mMaximumPastTime{1200};
+    std::chrono::seconds mMaximumFutureTime{0};
+    std::chrono::seconds mCircularBufferDuration{3600};
+    std::chrono::seconds mReapInterval{60};
+    std::chrono::microseconds mLastReapTime{0};
+    size_t mMemoryBudget{0};
+    int mNumberOfSources{0};
+};
+
+/// C'tor
+Engine::Engine() :
+    pImpl(std::make_unique<EngineImpl> ())
+{
+}
+
+/// Move c'tor
+Engine::Engine(Engine &&engine) noexcept
+{
+    *this = std::move(engine);
+}
+
+/// Move assignment
+Engine& Engine::operator=(Engine &&engine) noexcept
+{
+    if (&engine == this){return *this;}
+    pImpl = std::move(engine.pImpl);
+    return *this;
+}
+
+/// Destructor
+Engine::~Engine() = default;
+
+/// Reset class
+void Engine::clear() noexcept
+{
+    pImpl->mChannels.clear();
+    pImpl->mChannelHistories.clear();
+    pImpl->mLastActivity.clear();
+    pImpl->mFirstDeliveries.clear();
+    pImpl->mNumberOfSources = 0;
+    clearBadChannels();
+}
+
+/// Maximum past time
+void Engine::setMaximumPastTime(const std::chrono::seconds &maximumPastTime)
+{
+    if (maximumPastTime < std::chrono::seconds {0})
+    {
+        throw std::invalid_argument("Max past time is negative");
+    }
+    pImpl->mMaximumPastTime = maximumPastTime;
+}
+
+std::chrono::seconds Engine::getMaximumPastTime() const noexcept
+{
+    return pImpl->mMaximumPastTime;
+}
+
+/// Maximum future time
+void Engine::setMaximumFutureTime(const std::chrono::seconds &maximumFutureTime)
+{
+    if (maximumFutureTime < std::chrono::seconds {0})
+    {
+        throw std::invalid_argument("Max future time is negative");
+    }
+    pImpl->mMaximumFutureTime = maximumFutureTime;
+}
+
+std::chrono::seconds Engine::getMaximumFutureTime() const noexcept
+{
+    return pImpl->mMaximumFutureTime;
+}
+
+/// Circular buffer duration
+void Engine::setCircularBufferDuration(const std::chrono::seconds &duration)
+{
+    if (duration < std::chrono::seconds {0})
+    {
+        throw std::invalid_argument("Circular buffer duration is negative");
+    }
+    pImpl->mCircularBufferDuration = duration;
+}
+
+std::chrono::seconds Engine::getCircularBufferDuration() const noexcept
+{
+    return pImpl->mCircularBufferDuration;
+}
+
+/// Process a batch
+void Engine::process(const std::span<const TraceBuf2View> packets,
+                     const std::chrono::microseconds &now,
+                     std::vector<Decision> *decisions)
+{
+    process(packets, now, 0, decisions);
+}
+
+/// Process a batch from a source
+void Engine::process(const std::span<const TraceBuf2View> packets,
+                     const std::chrono::microseconds &now,
+                     const int source,
+                     std::vector<Decision> *decisions)
+{
+    if (source < 0)
+    {
+        throw std::invalid_argument("Source = " + std::to_string(source)
+                                  + " must be non-negative");
+    }
+    if (decisions == nullptr)
+    {
+        throw std::invalid_argument("decisions is NULL");
+    }
+    decisions->resize(packets.size());
+    pImpl->process(packets, now, source, false, decisions->data());
+    pImpl->reapIfNecessary(now);
+}
+
+/// Process a packet
+Decision Engine::process(const TraceBuf2View &packet,
+                         const std::chrono::microseconds &now)
+{
+    Decision decision;
+    pImpl->process(std::span<const TraceBuf2View> {&packet, 1}, now, 0,
+                   false, &decision);
+    pImpl->reapIfNecessary(now);
+    return decision;
+}
+
+/// Seed
+int Engine::seed(const std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now)
+{
+    std::vector<Decision> decisions(packets.size());
+    pImpl->process(packets, now, 0, true, decisions.data());
+    return static_cast<int> (std::count(decisions.begin(), decisions.end(),
+                                        Decision::Accept));
+}
+
+/// Number of channels
+int Engine::getNumberOfChannels() const noexcept
+{
+    return pImpl->mChannels.size();
+}
+
+int Engine::getNumberOfActiveChannels() const noexcept
+{
+    return static_cast<int> (std::count_if(pImpl->mChannelHistories.begin(),
+                                           pImpl->mChannelHistories.end(),
+                                           [](const ChannelHistory &history)
+                                           {
+                                               return history.isInitialized();
+                                           }));
+}
+
+/// Memory
+size_t Engine::getMemoryUsage() const noexcept
+{
+    return pImpl->getMemoryUsage();
+}
+
+/// Reaping
+void Engine::setMemoryBudget(const size_t budget) noexcept
+{
+    pImpl->mMemoryBudget = budget;
+}
+
+size_t Engine::getMemoryBudget() const noexcept
+{
+    return pImpl->mMemoryBudget;
+}
+
+void Engine::setReapInterval(const std::chrono::seconds &interval) noexcept
+{
+    pImpl->mReapInterval = interval;
+}
+
+std::chrono::seconds Engine::getReapInterval() const noexcept
+{
+    return pImpl->mReapInterval;
+}
+
+std::pair<int, int> Engine::reap(const std::chrono::microseconds &now)
+{
+    return pImpl->reap(now);
+}
+
+/// Bad channels
+std::vector<std::string> Engine::getExpiredChannels() const
+{
+    return ::toNames(pImpl->mExpiredChannels, pImpl->mChannels);
+}
+
+std::vector<std::string> Engine::getFutureChannels() const
+{
+    return ::toNames(pImpl->mFutureChannels, pImpl->mChannels);
+}
+
+std::vector<std::string> Engine::getDuplicateChannels() const
+{
+    return ::toNames(pImpl->mDuplicateChannels, pImpl->mChannels);
+}
+
+/// First deliveries
+std::vector<std::pair<std::string, std::vector<int>>>
+Engine::getFirstDeliveries() const
+{
+    std::vector<std::pair<std::string, std::vector<int>>> result;
+    auto nSources = pImpl->mNumberOfSources;
+    const auto &firstDeliveries = pImpl->mFirstDeliveries;
+    for (int i = 0; i < static_cast<int> (firstDeliveries.size()); ++i)
+    {
+        if (firstDeliveries[i].empty()){continue;}
+        std::vector<int> counts(nSources, 0);
+        std::copy(firstDeliveries[i].begin(), firstDeliveries[i].end(),
+                  counts.begin());
+        result.push_back(std::pair {pImpl->mChannels.getName(i),
+                                    std::move(counts)});
+    }
+    return result;
+}
+
+void Engine::clearFirstDeliveries() noexcept
+{
+    // Keep the outer memory since channels are rarely retired
+    for (auto &firstDeliveries : pImpl->mFirstDeliveries)
+    {
+        firstDeliveries.clear();
+    }
+}
+
+void Engine::clearBadChannels() noexcept
+{
+    pImpl->mExpiredChannels.clear();
+    pImpl->mFutureChannels.clear();
+    pImpl->mDuplicateChannels.clear();
+}
+
+/// Snapshots
+std::vector<Snapshot::Channel>
+Engine::exportChannels(const std::chrono::microseconds &now) const
+{
+    auto oldestStartTime = (now - pImpl->mMaximumPastTime).count();
+    std::vector<Snapshot::Channel> channels;
+    const auto &histories = pImpl->mChannelHistories;
+    for (int i = 0; i < static_cast<int> (histories.size()); ++i)
+    {
+        const auto &history = histories[i];
+        if (!history.isInitialized()){continue;}
+        Snapshot::Channel channel;
+        for (int j = 0; j < history.size(); ++j)
+        {
+            auto startTime = history.getStartTime(j).count();
+            if (startTime < oldestStartTime){continue;}
+            channel.startTimes.push_back(startTime);
+            channel.nSamples.push_back(history.getNumberOfSamples(j));
+        }
+        if (channel.startTimes.empty()){continue;}
+        channel.key = pImpl->mChannels.getKey(i);
+        channel.samplingRate = history.getSamplingRate();
+        channel.lastActivity = pImpl->mLastActivity[i].count();
+        channels.push_back(std::move(channel));
+    }
+    return channels;
+}
+
+int Engine::importChannels(const std::vector<Snapshot::Channel> &channels,
+                           const std::chrono::microseconds &now)
+{
+    auto oldestStartTime = (now - pImpl->mMaximumPastTime).count();
+    int nRestored = 0;
+    for (const auto &channel : channels)
+    {
+        if (!(channel.samplingRate > 0)){continue;}
+        if (channel.startTimes.empty() ||
+            channel.startTimes.back() < oldestStartTime)
+        {
+            continue;
+        }
+        auto identifier = pImpl->mChannels.intern(channel.key);
+        if (identifier >= static_cast<int> (pImpl->mChannelHistories.size()))
+        {
+            pImpl->mChannelHistories.resize(identifier + 1);
+            pImpl->mLastActivity.resize(identifier + 1);
+        }
+        auto &history = pImpl->mChannelHistories[identifier];
+        if (!history.isInitialized())
+        {
+            history = ChannelHistory {channel.samplingRate};
+        }
+        // The saved packets are sorted so this is a sequence of appends
+        for (size_t j = 0; j < channel.startTimes.size(); ++j)
+        {
+            if (channel.startTimes[j] < oldestStartTime){continue;}
+            std::chrono::microseconds startTime{channel.startTimes[j]};
+            if (history.contains(startTime)){continue;}
+            history.insert(startTime, channel.nSamples[j]);
+        }
+        pImpl->mLastActivity[identifier]
+            = std::max(pImpl->mLastActivity[identifier],
+                       std::chrono::microseconds {channel.lastActivity});
+        nRestored = nRestored + 1;
+    }
+    return nRestored;
+}
+
+void Engine::saveSnapshot(const std::filesystem::path &fileName,
+                          const std::chrono::microseconds &now) const
+{
+    Snapshot::write(fileName, now.count(), exportChannels(now));
+}
+
+int Engine::loadSnapshot(const std::filesystem::path &fileName,
+                         const std::chrono::microseconds &now)
+{
+    int64_t snapshotTime{0};
+    auto channels = Snapshot::read(fileName, &snapshotTime);
+    return importChannels(channels, now);
+}
@@ -0,0 +1,623 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <spdlog/spdlog.h>
+#include <deduplicator/fileRing.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/messageSlab.hpp>
+#include <deduplicator/channelKey.hpp>
+#include "captureFormat.hpp"
+#include "timeWindow.hpp"
+#include "traceBuf2Layout.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+/// Earthworm's TYPE_TRACEBUF2 in earthworm.d.  A file has no logo so the
+/// slab's messages are given this type.
+constexpr unsigned char TYPE_TRACEBUF2{19};
+
+/// Closes the file and unmaps the memory on destruction
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+    ~MappedFile()
+    {
+        if (mMemory != nullptr && mMemory != MAP_FAILED)
+        {
+            ::munmap(mMemory, mSize);
+        }
+        if (mDescriptor >= 0){::close(mDescriptor);}
+    }
+    void *mMemory{nullptr};
+    size_t mSize{0};
+    int mDescriptor{-1};
+};
+
+/// A message in a mapped file
+struct Message
+{
+    const char *data{nullptr};
+    /// When the virtual clock releases the message
+    int64_t releaseTime{0};
+    int length{0};
+};
+
+std::unique_ptr<MappedFile> mapFile(const std::filesystem::path &fileName)
+{
+    auto file = std::make_unique<MappedFile> ();
+    file->mDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (file->mDescriptor < 0)
+    {
+        throw std::runtime_error("Could not open " + fileName.string());
+    }
+    struct stat status;
+    if (::fstat(file->mDescriptor, &status) != 0)
+    {
+        throw std::runtime_error("Could not stat " + fileName.string());
+    }
+    file->mSize = static_cast<size_t> (status.st_size);
+    // Nothing to map
+    if (file->mSize == 0){return file;}
+    file->mMemory = ::mmap(nullptr, file->mSize, PROT_READ, MAP_PRIVATE,
+                           file->mDescriptor, 0);
+    if (file->mMemory == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + fileName.string());
+    }
+    // The file is read front to back once
+    ::madvise(file->mMemory, file->mSize, MADV_SEQUENTIAL);
+    return file;
+}
+
+/// @result The length of the traceBuf2 message implied by its header or
+///         -1 if the bytes do not look like a traceBuf2 message.
+int64_t getTraceBuf2Length(const char *message, const size_t nBytes) noexcept
+{
+    using namespace TraceBuf2Layout;
+    if (nBytes < static_cast<size_t> (HEADER_SIZE) ||
+        !isSupportedDataType(message))
+    {
+        return -1;
+    }
+    auto nSamples
+        = unpack<int> (message + NUMBER_OF_SAMPLES_OFFSET, needsSwap(message));
+    auto sampleSize = static_cast<int> (message[DATA_TYPE_OFFSET + 1] - '0');
+    auto length = static_cast<int64_t> (HEADER_SIZE)
+                + static_cast<int64_t> (nSamples)*sampleSize;
+    if (nSamples < 0 ||
+        length > MAXIMUM_MESSAGE_SIZE ||
+        static_cast<size_t> (length) > nBytes)
+    {
+        return -1;
+    }
+    return length;
+}
+
+/// Finds the messages in a tank file
+void indexTank(const std::filesystem::path &fileName,
+               const MappedFile &file,
+               std::vector<Message> *messages)
+{
+    auto buffer = static_cast<const char *> (file.mMemory);
+    size_t offset = 0;
+    while (offset < file.mSize)
+    {
+        auto message = buffer + offset;
+        auto length = ::getTraceBuf2Length(message, file.mSize - offset);
+        if (length < 0)
+        {
+            throw std::runtime_error("Corrupt message at byte "
+                                   + std::to_string(offset) + " of "
+                                   + fileName.string());
+        }
+        // A packet is on the ring once its last sample was digitized
+        auto times = TraceBuf2Layout::unpackTimes(message);
+        Message entry;
+        entry.data = message;
+        entry.releaseTime = times.valid ? times.endTime : times.startTime;
+        entry.length = static_cast<int> (length);
+        messages->push_back(entry);
+        offset = offset + static_cast<size_t> (length);
+    }
+}
+
+/// Finds the traceBuf2 messages in a capture
+void indexCapture(const std::filesystem::path &fileName,
+                  const MappedFile &file,
+                  std::vector<Message> *messages)
+{
+    using namespace CaptureFormat;
+    auto buffer = static_cast<const char *> (file.mMemory);
+    auto version = unpackVersion(buffer);
+    if (version != VERSION)
+    {
+        throw std::runtime_error("Unsupported capture version "
+                               + std::to_string(version) + " in "
+                               + fileName.string());
+    }
+    int nSkipped = 0;
+    auto offset = static_cast<size_t> (FILE_HEADER_SIZE);
+    while (offset < file.mSize)
+    {
+        auto record = buffer + offset;
+        if (offset + RECORD_HEADER_SIZE > file.mSize)
+        {
+            throw std::runtime_error("Corrupt record at byte "
+                                   + std::to_string(offset) + " of "
+                                   + fileName.string());
+        }
+        auto length
+            = TraceBuf2Layout::unpack<uint32_t> (record + LENGTH_OFFSET,
+                                                 needsSwap());
+        auto recordSize = getRecordSize(length);
+        if (offset + recordSize > file.mSize)
+        {
+            throw std::runtime_error("Corrupt record at byte "
+                                   + std::to_string(offset) + " of "
+                                   + fileName.string());
+        }
+        // Other message types on the ring are kept out of the replay
+        auto message = record + RECORD_HEADER_SIZE;
+        if (::getTraceBuf2Length(message, length) == length)
+        {
+            Message entry;
+            entry.data = message;
+            entry.releaseTime
+                = TraceBuf2Layout::unpack<int64_t>
+                  (record + ARRIVAL_TIME_OFFSET, needsSwap());
+            entry.length = static_cast<int> (length);
+            messages->push_back(entry);
+        }
+        else
+        {
+            nSkipped = nSkipped + 1;
+        }
+        offset = offset + recordSize;
+    }
+    if (nSkipped > 0)
+    {
+        spdlog::get("deduplicator")->info("Skipped "
+                                        + std::to_string(nSkipped)
+                                        + " non-traceBuf2 messages in "
+                                        + fileName.string());
+    }
+}
+
+std::chrono::microseconds getWallTime() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>
+           (std::chrono::steady_clock::now().time_since_epoch());
+}
+
+}
+
+class FileRing::FileRingImpl
+{
+public:
+    /// The virtual clock
+    [[nodiscard]] std::chrono::microseconds getNow() const noexcept
+    {
+        if (mReplaySpeed > 0 && mStarted)
+        {
+            auto elapsed = static_cast<double> ((::getWallTime()
+                                               - mWallStartTime).count());
+            return mStartTime
+                 + std::chrono::microseconds {static_cast<int64_t>
+                                              (elapsed*mReplaySpeed)};
+        }
+        return mCurrentTime;
+    }
+    /// Views of the messages in the slab
+    std::vector<TraceBuf2View> mTraceBuf2Views;
+    /// The messages copied out of the files.  This is reused between reads.
+    MessageSlab mMessageSlab;
+    /// The mapped files and the messages in them
+    std::vector<std::unique_ptr<MappedFile>> mFiles;
+    std::vector<Message> mMessages;
+    std::vector<std::filesystem::path> mFileNames;
+    /// The file to which written messages are appended
+    std::ofstream mOutputFile;
+    TimeWindow mTimeWindow;
+    /// The virtual time when replaying as fast as possible or when the
+    /// replay started
+    std::chrono::microseconds mCurrentTime{0};
+    std::chrono::microseconds mStartTime{0};
+    /// The wall time when the replay started
+    std::chrono::microseconds mWallStartTime{0};
+    double mReplaySpeed{0};
+    /// The next message to release
+    size_t mNextMessage{0};
+    int mMaximumBatchSize{1024};
+    bool mStarted{false};
+    bool mReading{false};
+    bool mWriting{false};
+};
+
+/// C'tor
+FileRing::FileRing() :
+    pImpl(std::make_unique<FileRingImpl> ())
+{
+}
+
+/// Move c'tor
+FileRing::FileRing(FileRing &&fileRing) noexcept
+{
+    *this = std::move(fileRing);
+}
+
+/// Move assignment
+FileRing& FileRing::operator=(FileRing &&fileRing) noexcept
+{
+    if (&fileRing == this){return *this;}
+    pImpl = std::move(fileRing.pImpl);
+    return *this;
+}
+
+/// Destructor
+FileRing::~FileRing()
+{
+    disconnect();
+}
+
+/// Disconnect
+void FileRing::disconnect() noexcept
+{
+    // Nothing to do for a ring that was moved
+    if (!pImpl){return;}
+    pImpl->mTraceBuf2Views.clear();
+    pImpl->mMessageSlab.release();
+    pImpl->mMessages.clear();
+    pImpl->mFiles.clear();
+    pImpl->mFileNames.clear();
+    if (pImpl->mOutputFile.is_open()){pImpl->mOutputFile.close();}
+    pImpl->mCurrentTime = std::chrono::microseconds {0};
+    pImpl->mStartTime = std::chrono::microseconds {0};
+    pImpl->mWallStartTime = std::chrono::microseconds {0};
+    pImpl->mNextMessage = 0;
+    pImpl->mStarted = false;
+    pImpl->mReading = false;
+    pImpl->mWriting = false;
+}
+
+/// Open
+void FileRing::open(const std::vector<std::filesystem::path> &files)
+{
+    if (files.empty()){throw std::invalid_argument("No files");}
+    for (const auto &file : files)
+    {
+        if (!std::filesystem::exists(file))
+        {
+            throw std::invalid_argument(file.string() + " does not exist");
+        }
+    }
+    disconnect();
+    try
+    {
+        for (const auto &file : files)
+        {
+            pImpl->mFiles.push_back(::mapFile(file));
+            const auto &mappedFile = *pImpl->mFiles.back();
+            if (CaptureFormat::isCapture(
+                    static_cast<const char *> (mappedFile.mMemory),
+                    mappedFile.mSize))
+            {
+                ::indexCapture(file, mappedFile, &pImpl->mMessages);
+            }
+            else
+            {
+                ::indexTank(file, mappedFile, &pImpl->mMessages);
+            }
+            pImpl->mFileNames.push_back(file);
+        }
+    }
+    catch (...)
+    {
+        disconnect();
+        throw;
+    }
+    if (!pImpl->mMessages.empty())
+    {
+        auto earliest
+            = std::min_element(pImpl->mMessages.begin(),
+                               pImpl->mMessages.end(),
+                               [](const Message &lhs, const Message &rhs)
+                               {
+                                   return lhs.releaseTime < rhs.releaseTime;
+                               });
+        pImpl->mCurrentTime = std::chrono::microseconds {earliest->releaseTime};
+    }
+    pImpl->mReading = true;
+    spdlog::get("deduplicator")->info("Opened "
+                                    + std::to_string(pImpl->mMessages.size())
+                                    + " messages for replay");
+}
+
+/// Create
+void FileRing::create(const std::filesystem::path &file)
+{
+    disconnect();
+    if (file.has_parent_path() && !std::filesystem::exists(file.parent_path()))
+    {
+        std::filesystem::create_directories(file.parent_path());
+    }
+    pImpl->mOutputFile.open(file, std::ios::binary | std::ios::trunc);
+    if (!pImpl->mOutputFile.is_open())
+    {
+        throw std::runtime_error("Could not create " + file.string());
+    }
+    pImpl->mFileNames.push_back(file);
+    pImpl->mWriting = true;
+}
+
+/// Connected?
+bool FileRing::isConnected() const noexcept
+{
+    return pImpl->mReading || pImpl->mWriting;
+}
+
+/// Name
+std::string FileRing::getRingName() const
+{
+    if (!isConnected()){throw std::runtime_error("No file is open");}
+    return pImpl->mFileNames.at(0).string();
+}
+
+/// Clock
+std::chrono::microseconds FileRing::getNow() const noexcept
+{
+    return pImpl->getNow();
+}
+
+/// Replay speed
+void FileRing::setReplaySpeed(const double speed)
+{
+    if (speed < 0){throw std::invalid_argument("Replay speed is negative");}
+    pImpl->mReplaySpeed = speed;
+}
+
+double FileRing::getReplaySpeed() const noexcept
+{
+    return pImpl->mReplaySpeed;
+}
+
+/// Batch size
+void FileRing::setMaximumBatchSize(const int batchSize)
+{
+    if (batchSize < 1)
+    {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    pImpl->mMaximumBatchSize = batchSize;
+}
+
+int FileRing::getMaximumBatchSize() const noexcept
+{
+    return pImpl->mMaximumBatchSize;
+}
+
+/// Counts
+int64_t FileRing::getNumberOfMessages() const noexcept
+{
+    return static_cast<int64_t> (pImpl->mMessages.size());
+}
+
+int64_t FileRing::getNumberOfReleasedMessages() const noexcept
+{
+    return static_cast<int64_t> (pImpl->mNextMessage);
+}
+
+/// Time window
+void FileRing::setTimeWindow(const std::chrono::seconds &maximumPastTime,
+                             const std::chrono::seconds &maximumFutureTime)
+{
+    pImpl->mTimeWindow.set(maximumPastTime, maximumFutureTime);
+}
+
+bool FileRing::haveTimeWindow() const noexcept
+{
+    return pImpl->mTimeWindow.isEnabled();
+}
+
+std::vector<std::string> FileRing::getExpiredChannels() const
+{
+    return pImpl->mTimeWindow.getExpiredChannels();
+}
+
+std::vector<std::string> FileRing::getFutureChannels() const
+{
+    return pImpl->mTimeWindow.getFutureChannels();
+}
+
+void FileRing::clearRejectedChannels() noexcept
+{
+    pImpl->mTimeWindow.clearRejectedChannels();
+}
+
+/// Flush
+void FileRing::flush()
+{
+    if (!isConnected()){throw std::runtime_error("No file is open");}
+    pImpl->mTraceBuf2Views.clear();
+    pImpl->mMessageSlab.clear();
+}
+
+/// Read
+void FileRing::read()
+{
+    read(&pImpl->mMessageSlab, &pImpl->mTraceBuf2Views);
+}
+
+void FileRing::read(MessageSlab *messageSlab,
+                    std::vector<TraceBuf2View> *traceBuf2Views)
+{
+    if (messageSlab == nullptr)
+    {
+        throw std::invalid_argument("messageSlab is NULL");
+    }
+    if (traceBuf2Views == nullptr)
+    {
+        throw std::invalid_argument("traceBuf2Views is NULL");
+    }
+    if (!pImpl->mReading){throw std::runtime_error("No file open for reading");}
+    const auto &messages = pImpl->mMessages;
+    auto &next = pImpl->mNextMessage;
+    if (next >= messages.size())
+    {
+        throw TerminateException("Reached the end of the replay");
+    }
+    auto &slab = *messageSlab;
+    slab.clear();
+    traceBuf2Views->clear();
+    // Start the clock on the first read so setup is not part of the replay
+    if (!pImpl->mStarted)
+    {
+        // A timed replay releases each message when its time comes, which
+        // need not be file order, e.g., a late packet in a tank file or
+        // files given out of order
+        if (pImpl->mReplaySpeed > 0)
+        {
+            std::stable_sort(pImpl->mMessages.begin(),
+                             pImpl->mMessages.end(),
+                             [](const Message &lhs, const Message &rhs)
+                             {
+                                 return lhs.releaseTime < rhs.releaseTime;
+                             });
+        }
+        pImpl->mStartTime = pImpl->mCurrentTime;
+        pImpl->mWallStartTime = ::getWallTime();
+        pImpl->mStarted = true;
+    }
+    // Release the messages whose time has come
+    auto nBatch = std::min(static_cast<size_t> (pImpl->mMaximumBatchSize),
+                           messages.size() - next);
+    auto last = next;
+    if (pImpl->mReplaySpeed > 0)
+    {
+        auto now = pImpl->getNow().count();
+        while (last < next + nBatch && messages[last].releaseTime <= now)
+        {
+            last = last + 1;
+        }
+    }
+    else
+    {
+        // As fast as possible so jump the clock to the batch
+        last = next + nBatch;
+        for (auto i = next; i < last; ++i)
+        {
+            pImpl->mCurrentTime
+                = std::max(pImpl->mCurrentTime,
+                           std::chrono::microseconds {messages[i].releaseTime});
+        }
+    }
+    auto &timeWindow = pImpl->mTimeWindow;
+    if (timeWindow.isEnabled()){timeWindow.update(pImpl->getNow());}
+    size_t nBytes = 0;
+    for (auto i = next; i < last; ++i)
+    {
+        nBytes = nBytes + static_cast<size_t> (messages[i].length);
+    }
+    slab.reserve(nBytes, static_cast<int> (last - next));
+    for (auto i = next; i < last; ++i)
+    {
+        const auto &message = messages[i];
+        auto length = static_cast<size_t> (message.length);
+        if (timeWindow.isEnabled() &&
+            timeWindow.reject(message.data, length,
+                              [this]() {return pImpl->getNow();}))
+        {
+            continue;
+        }
+        auto messagePtr = slab.beginMessage(length);
+        std::copy(message.data, message.data + length, messagePtr);
+        slab.commitMessage(length, ::TYPE_TRACEBUF2);
+    }
+    next = last;
+    // Create views of the messages.  This does not copy.
+    auto &views = *traceBuf2Views;
+    for (int it = 0; it < slab.size(); ++it)
+    {
+        auto message = slab.getMessage(it);
+        try
+        {
+            TraceBuf2View view{message.data(), message.size()};
+            // Evict any empty messages
+            if (view.getNumberOfSamples() > 0){views.push_back(view);}
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::get("deduplicator")->warn(
+                "Failed to unpack message.  Failed with: "
+              + std::string {e.what()});
+        }
+    }
+}
+
+const std::vector<TraceBuf2View>
+&FileRing::getTraceBuf2ViewsReference() const noexcept
+{
+    return pImpl->mTraceBuf2Views;
+}
+
+/// Write
+void FileRing::write(const TraceBuf2View &message)
+{
+    if (!pImpl->mWriting){throw std::runtime_error("No file open for writing");}
+    pImpl->mOutputFile.write(message.getNativePacketPointer(),
+                             static_cast<std::streamsize>
+                             (message.getMessageLength()));
+    if (!pImpl->mOutputFile)
+    {
+        pImpl->mOutputFile.clear();
+        throw std::runtime_error("Failed to write "
+                               + message.getChannelKey().toName()
+                               + " to file");
+    }
+}
+
+WriteSummary FileRing::writeBatch(const std::span<const TraceBuf2View> messages)
+{
+    if (!pImpl->mWriting){throw std::runtime_error("No file open for writing");}
+    WriteSummary summary;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &message : messages)
+    {
+        pImpl->mOutputFile.write(message.getNativePacketPointer(),
+                                 static_cast<std::streamsize>
+                                 (message.getMessageLength()));
+        if (pImpl->mOutputFile)
+        {
+            summary.nWritten = summary.nWritten + 1;
+        }
+        else
+        {
+            pImpl->mOutputFile.clear();
+            summary.nFailed = summary.nFailed + 1;
+        }
+    }
+    pImpl->mOutputFile.flush();
+    summary.duration
+        = std::chrono::duration_cast<std::chrono::microseconds>
+          (std::chrono::steady_clock::now() - start);
+    return summary;
+}
+
+/// Heartbeat
+void FileRing::writeHeartbeat(const bool terminate)
+{
+    if (terminate && pImpl->mOutputFile.is_open())
+    {
+        pImpl->mOutputFile.flush();
+    }
+}
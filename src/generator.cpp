@@ -0,0 +1,432 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <array>
+#include <numeric>
+#include <deque>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <boost/program_options.hpp>
+#include <deduplicator/waveRing.hpp>
+#include <deduplicator/fileRing.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include "traceBuf2Builder.hpp"
+#include "version.hpp"
+
+namespace
+{
+
+/// Splits a comma-separated list and trims the whitespace from each item.
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> result;
+    std::string::size_type start = 0;
+    while (start <= list.size())
+    {
+        auto end = list.find(',', start);
+        if (end == std::string::npos){end = list.size();}
+        auto item = list.substr(start, end - start);
+        auto first = item.find_first_not_of(" \t");
+        if (first != std::string::npos)
+        {
+            auto last = item.find_last_not_of(" \t");
+            result.push_back(item.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+/// The sample formats a data logger may send.  i and f are little endian
+/// while s and t are big endian.
+bool isValidDataType(const std::string &dataType)
+{
+    constexpr std::array<const char *, 8> DATA_TYPES{"i2", "i4", "f4", "f8",
+                                                     "s2", "s4", "t4", "t8"};
+    return std::find(DATA_TYPES.begin(), DATA_TYPES.end(), dataType)
+        != DATA_TYPES.end();
+}
+
+struct ProgramOptions
+{
+    void parseCommandLineOptions(int argc, char *argv[])
+    {
+        boost::program_options::options_description desc(
+R"""(
+The deduplicator-generator writes synthetic TraceBuf2 packets to a tank
+file or an Earthworm ring.  Duplicated, out of order, and clock skewed
+packets can be mixed in to load the deduplicator beyond what the network
+produces today.
+    deduplicator-generator --channels=5000 --outputFile=synthetic.tnk
+Allowed options)""");
+        desc.add_options()
+            ("help", "Produces this help message")
+            ("channels",
+             boost::program_options::value<int> ()->default_value(100),
+             "The number of channels")
+            ("samplingRates",
+             boost::program_options::value<std::string> ()->default_value("100,40"),
+             "A comma-separated list of sampling rates in Hz.  The channels cycle through these.")
+            ("dataTypes",
+             boost::program_options::value<std::string> ()->default_value("i4"),
+             "A comma-separated list of i2, i4, f4, f8 (little endian) or s2, s4, t4, t8 (big endian).  The channels cycle through these.")
+            ("packetDuration",
+             boost::program_options::value<double> ()->default_value(1),
+             "The packet duration in seconds.  This is shortened if the packet would not fit in 4096 bytes in which case the channel sends more packets.")
+            ("duration",
+             boost::program_options::value<double> ()->default_value(60),
+             "The seconds of data to generate for each channel")
+            ("startTime",
+             boost::program_options::value<double> (),
+             "The start time in seconds from the epoch.  By default this is now or, when generating as fast as possible, now minus the duration.")
+            ("duplicationRatio",
+             boost::program_options::value<double> ()->default_value(0),
+             "The fraction of packets in [0,1] that are sent again")
+            ("outOfOrderFraction",
+             boost::program_options::value<double> ()->default_value(0),
+             "The fraction of packets in [0,1] that are held back until after the following packets")
+            ("clockSkew",
+             boost::program_options::value<double> ()->default_value(0),
+             "Each channel's clock is off by a random amount up to this many seconds either way")
+            ("speed",
+             boost::program_options::value<double> ()->default_value(0),
+             "0 generates as fast as possible.  Otherwise, the packets are sent this many times faster than real time.")
+            ("seed",
+             boost::program_options::value<unsigned int> ()->default_value(86754),
+             "The random number seed")
+            ("outputFile", boost::program_options::value<std::string> (),
+                           "The tank file to write")
+            ("outputRingName", boost::program_options::value<std::string> (),
+                               "The Earthworm ring to write")
+            ("moduleIdentifier",
+             boost::program_options::value<std::string> ()->default_value("MOD_WILDCARD"),
+             "The module identifier when writing to a ring")
+            ("version", "Displays the version number");
+        boost::program_options::variables_map vm;
+        boost::program_options::store(
+            boost::program_options::parse_command_line(argc, argv, desc), vm);
+        boost::program_options::notify(vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc << std::endl;
+            runProgram = false;
+            return;
+        }
+        if (vm.count("version"))
+        {
+            std::cout << Deduplicator::Version::getVersion() << std::endl;
+            runProgram = false;
+            return;
+        }
+        nChannels = vm["channels"].as<int> ();
+        if (nChannels < 1 || nChannels > 99999)
+        {
+            throw std::invalid_argument("channels must be in [1,99999]");
+        }
+        samplingRates.clear();
+        for (const auto &rate : splitList(vm["samplingRates"].as<std::string> ()))
+        {
+            samplingRates.push_back(std::stod(rate));
+            if (samplingRates.back() <= 0)
+            {
+                throw std::invalid_argument("Sampling rate must be positive");
+            }
+        }
+        if (samplingRates.empty())
+        {
+            throw std::invalid_argument("No sampling rates");
+        }
+        dataTypes = splitList(vm["dataTypes"].as<std::string> ());
+        if (dataTypes.empty()){throw std::invalid_argument("No data types");}
+        for (const auto &dataType : dataTypes)
+        {
+            if (!::isValidDataType(dataType))
+            {
+                throw std::invalid_argument("Unhandled data type: "
+                                          + dataType);
+            }
+        }
+        packetDuration = vm["packetDuration"].as<double> ();
+        if (packetDuration <= 0)
+        {
+            throw std::invalid_argument("Packet duration must be positive");
+        }
+        duration = vm["duration"].as<double> ();
+        if (duration <= 0)
+        {
+            throw std::invalid_argument("Duration must be positive");
+        }
+        duplicationRatio = vm["duplicationRatio"].as<double> ();
+        if (duplicationRatio < 0 || duplicationRatio > 1)
+        {
+            throw std::invalid_argument("Duplication ratio must be in [0,1]");
+        }
+        outOfOrderFraction = vm["outOfOrderFraction"].as<double> ();
+        if (outOfOrderFraction < 0 || outOfOrderFraction > 1)
+        {
+            throw std::invalid_argument(
+                "Out of order fraction must be in [0,1]");
+        }
+        clockSkew = std::abs(vm["clockSkew"].as<double> ());
+        speed = vm["speed"].as<double> ();
+        if (speed < 0){throw std::invalid_argument("Speed is negative");}
+        auto now = std::chrono::duration<double>
+                   (std::chrono::system_clock::now().time_since_epoch()).count();
+        startTime = speed > 0 ? now : now - duration;
+        if (vm.count("startTime")){startTime = vm["startTime"].as<double> ();}
+        seed = vm["seed"].as<unsigned int> ();
+        if (vm.count("outputFile"))
+        {
+            outputFile = vm["outputFile"].as<std::string> ();
+        }
+        if (vm.count("outputRingName"))
+        {
+            outputRingName = vm["outputRingName"].as<std::string> ();
+        }
+        if (outputFile.empty() == outputRingName.empty())
+        {
+            throw std::invalid_argument(
+                "Specify one of outputFile or outputRingName");
+        }
+        moduleName = vm["moduleIdentifier"].as<std::string> ();
+    }
+    std::vector<double> samplingRates;
+    std::vector<std::string> dataTypes;
+    std::filesystem::path outputFile;
+    std::string outputRingName;
+    std::string moduleName;
+    double packetDuration{1};
+    double duration{60};
+    double startTime{0};
+    double duplicationRatio{0};
+    double outOfOrderFraction{0};
+    double clockSkew{0};
+    double speed{0};
+    unsigned int seed{86754};
+    int nChannels{100};
+    bool runProgram{true};
+};
+
+/// A synthetic channel
+struct Channel
+{
+    std::string station;
+    std::string dataType;
+    double samplingRate{0};
+    /// How far off the channel's clock is in seconds
+    double skew{0};
+    int nSamplesPerPacket{0};
+    int pinNumber{0};
+};
+
+/// A packet waiting to be sent
+struct Pending
+{
+    std::vector<char> message;
+    /// The step after which this is sent
+    int64_t step{0};
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+    ProgramOptions options;
+    try
+    {
+        options.parseCommandLineOptions(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!options.runProgram){return EXIT_SUCCESS;}
+    // The library logs through this
+    auto logger = spdlog::stdout_logger_mt("deduplicator");
+    logger->set_level(spdlog::level::warn);
+
+    // Lay out the channels
+    using namespace Deduplicator::TraceBuf2Layout;
+    using Deduplicator::TraceBuf2Builder::createMessage;
+    std::mt19937 generator(options.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<Channel> channels(options.nChannels);
+    for (int i = 0; i < options.nChannels; ++i)
+    {
+        auto &channel = channels[i];
+        auto stationNumber = std::to_string(i);
+        channel.station = "S"
+                        + std::string(5 - stationNumber.size(), '0')
+                        + stationNumber;
+        channel.samplingRate
+            = options.samplingRates[i % options.samplingRates.size()];
+        channel.dataType = options.dataTypes[i % options.dataTypes.size()];
+        channel.skew = options.clockSkew*(2*uniform(generator) - 1);
+        channel.pinNumber = i;
+        auto sampleSize = static_cast<int> (channel.dataType[1] - '0');
+        auto maximumSamples = (MAXIMUM_MESSAGE_SIZE - HEADER_SIZE)/sampleSize;
+        channel.nSamplesPerPacket
+            = std::max(1, std::min(maximumSamples,
+                                   static_cast<int> (std::lround(
+                                   options.packetDuration
+                                  *channel.samplingRate))));
+    }
+
+    // Open the destination
+    std::unique_ptr<Deduplicator::IWaveRing> outputRing;
+    try
+    {
+        if (!options.outputFile.empty())
+        {
+            auto fileRing = std::make_unique<Deduplicator::FileRing> ();
+            fileRing->create(options.outputFile);
+            outputRing = std::move(fileRing);
+        }
+        else
+        {
+            auto waveRing = std::make_unique<Deduplicator::WaveRing> ();
+            waveRing->connect(options.outputRingName, options.moduleName);
+            outputRing = std::move(waveRing);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Each step sends every packet that was completed during the step.  A
+    // packet spans nSamplesPerPacket/samplingRate seconds, which is less
+    // than the packet duration if the packet had to be shortened, so a
+    // channel may complete several packets in a step.  A step's packets are
+    // sent in a random order along with whatever was held back from
+    // earlier.
+    auto nSteps
+        = static_cast<int64_t> (std::ceil(options.duration
+                                        /options.packetDuration));
+    std::vector<int64_t> nextSample(channels.size(), 0);
+    std::vector<int> order(channels.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::deque<Pending> pending;
+    std::vector<std::vector<char>> batch;
+    std::vector<Deduplicator::TraceBuf2View> views;
+    int64_t nPackets{0};
+    int64_t nDuplicates{0};
+    int64_t nOutOfOrder{0};
+    int64_t nBytes{0};
+    int64_t nFailed{0};
+    auto wallStartTime = std::chrono::steady_clock::now();
+    for (int64_t step = 0; step <= nSteps + 2; ++step)
+    {
+        batch.clear();
+        if (step < nSteps)
+        {
+            std::shuffle(order.begin(), order.end(), generator);
+            // Packets that end by the end of this step are complete.  The
+            // last step finishes the duration.
+            auto stepEndTime = (step + 1)*options.packetDuration;
+            auto isDue = [&](const int i)
+            {
+                const auto &channel = channels[i];
+                auto offset = nextSample[i]/channel.samplingRate;
+                auto span = channel.nSamplesPerPacket/channel.samplingRate;
+                if (offset >= options.duration){return false;}
+                // Allow for round off with half a sample
+                return step == nSteps - 1 ||
+                       offset + span <= stepEndTime
+                                      + 0.5/channel.samplingRate;
+            };
+            for (auto i : order)
+            {
+                const auto &channel = channels[i];
+                while (isDue(i))
+                {
+                    auto startTime = options.startTime
+                                   + nextSample[i]/channel.samplingRate
+                                   + channel.skew;
+                    auto message = createMessage(
+                        Deduplicator::ChannelKey {"XX", channel.station,
+                                                  "HHZ", "00"},
+                        startTime, channel.dataType,
+                        channel.nSamplesPerPacket, channel.samplingRate,
+                        channel.pinNumber, nextSample[i]);
+                    nextSample[i] = nextSample[i] + channel.nSamplesPerPacket;
+                    if (uniform(generator) < options.duplicationRatio)
+                    {
+                        // The copy shows up up to two steps later, e.g.,
+                        // from another telemetry path
+                        auto delay = static_cast<int64_t> (generator() % 3);
+                        pending.push_back(Pending {message, step + delay});
+                        nDuplicates = nDuplicates + 1;
+                    }
+                    if (uniform(generator) < options.outOfOrderFraction)
+                    {
+                        pending.push_back(Pending {std::move(message),
+                                                   step + 1});
+                        nOutOfOrder = nOutOfOrder + 1;
+                        continue;
+                    }
+                    batch.push_back(std::move(message));
+                }
+            }
+        }
+        // Release what was held back
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (it->step <= step)
+            {
+                batch.push_back(std::move(it->message));
+                it = pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        if (batch.empty()){continue;}
+        // Pace the traffic
+        if (options.speed > 0)
+        {
+            auto sendTime
+                = wallStartTime
+                + std::chrono::microseconds {static_cast<int64_t> (
+                      1.e6*(step + 1)*options.packetDuration/options.speed)};
+            std::this_thread::sleep_until(sendTime);
+        }
+        views.clear();
+        for (const auto &message : batch)
+        {
+            views.emplace_back(message.data(), message.size());
+            nBytes = nBytes + static_cast<int64_t> (message.size());
+        }
+        try
+        {
+            auto summary = outputRing->writeBatch(views);
+            nPackets = nPackets + summary.nWritten;
+            nFailed = nFailed + summary.nFailed;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    outputRing->disconnect();
+    auto elapsed
+        = std::chrono::duration<double> (std::chrono::steady_clock::now()
+                                       - wallStartTime).count();
+    std::cout << "Wrote " << nPackets << " packets (" << nBytes
+              << " bytes) for " << channels.size() << " channels in "
+              << elapsed << " s" << std::endl;
+    std::cout << "Duplicates: " << nDuplicates
+              << "; Out of order: " << nOutOfOrder
+              << "; Failed: " << nFailed << std::endl;
+    return EXIT_SUCCESS;
+}
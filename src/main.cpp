@@ -1,8 +1,8 @@
 #include <iostream>
 #include <chrono>
-#include <set>
-#include <map>
-#include <cmath>
+#include <thread>
+#include <vector>
+#include <algorithm>
 #include <string>
 #include <filesystem>
 #include <spdlog/spdlog.h>
@@ -10,11 +10,65 @@
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/ini_parser.hpp>
-#include <boost/circular_buffer.hpp>
 #include <deduplicator/waveRing.hpp>
-#include <deduplicator/traceBuf2.hpp>
+#include <deduplicator/fileRing.hpp>
+#include <deduplicator/captureRecorder.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/engine.hpp>
+#include <deduplicator/shardedEngine.hpp>
+#include <deduplicator/pipeline.hpp>
+#include <deduplicator/pollingStrategy.hpp>
 #include "version.hpp"
 
+/// Splits a comma-separated list and trims the whitespace from each item.
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> result;
+    std::string::size_type start = 0;
+    while (start <= list.size())
+    {
+        auto end = list.find(',', start);
+        if (end == std::string::npos){end = list.size();}
+        auto item = list.substr(start, end - start);
+        auto first = item.find_first_not_of(" \t");
+        if (first != std::string::npos)
+        {
+            auto last = item.find_last_not_of(" \t");
+            result.push_back(item.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+/// Checkpoints the engine.  Failing to do so is not fatal.
+void saveSnapshot(const Deduplicator::ShardedEngine &engine,
+                  const std::filesystem::path &snapshotFile,
+                  const std::chrono::microseconds &now)
+{
+    try
+    {
+        engine.saveSnapshot(snapshotFile, now);
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::get("deduplicator")->warn("Failed to save snapshot: "
+                                        + std::string {e.what()});
+    }
+}
+
+/// Merges the channels the ring rejected with those the engine rejected
+std::vector<std::string> mergeChannels(std::vector<std::string> &&channels,
+                                       const std::vector<std::string> &more)
+{
+    channels.insert(channels.end(), more.begin(), more.end());
+    std::sort(channels.begin(), channels.end());
+    channels.erase(std::unique(channels.begin(), channels.end()),
+                   channels.end());
+    return channels;
+}
+
 struct ProgramOptions
 {
     void parseCommandLineOptions(int argc, char *argv[])
@@ -77,17 +131,74 @@ Allowed options)""");
         {
             throw std::invalid_argument("moduleIdentifier not specified");
         }
-        inputRingName
-            = propertyTree.get<std::string> ("inputRingName");
-        if (inputRingName.empty())
+        // Replaying tank files takes the place of the input rings
+        replayFiles.clear();
+        for (const auto &replayFile :
+             splitList(propertyTree.get<std::string> ("replayFiles", "")))
         {
-            throw std::invalid_argument("inputRingName not specified");
-        } 
-        outputRingName
-            = propertyTree.get<std::string> ("outputRingName");
-        if (outputRingName.empty())
+            if (!std::filesystem::exists(replayFile))
+            {
+                throw std::invalid_argument("Replay file " + replayFile
+                                          + " does not exist");
+            }
+            replayFiles.push_back(replayFile);
+        }
+        replaySpeed = propertyTree.get<double> ("replaySpeed", replaySpeed);
+        if (replaySpeed < 0)
+        {
+            throw std::invalid_argument("Replay speed is negative");
+        }
+        // A comma-separated list of rings, e.g., one per telemetry path
+        inputRingNames.clear();
+        if (replayFiles.empty())
+        {
+            inputRingNames
+                = splitList(propertyTree.get<std::string> ("inputRingName"));
+            if (inputRingNames.empty())
+            {
+                throw std::invalid_argument("inputRingName not specified");
+            }
+        }
+        for (size_t i = 0; i < inputRingNames.size(); ++i)
+        {
+            for (size_t j = i + 1; j < inputRingNames.size(); ++j)
+            {
+                if (inputRingNames[i] == inputRingNames[j])
+                {
+                    throw std::invalid_argument("Input ring "
+                                              + inputRingNames[i]
+                                              + " specified twice");
+                }
+            }
+        }
+        // Record the input rings for replay
+        captureDirectory
+            = propertyTree.get<std::string> ("captureDirectory",
+                                             captureDirectory.string());
+        captureFileSize
+            = propertyTree.get<int> ("captureFileSize", captureFileSize);
+        if (captureFileSize < 1)
+        {
+            throw std::invalid_argument("captureFileSize must be positive");
+        }
+        captureFiles = propertyTree.get<int> ("captureFiles", captureFiles);
+        if (captureFiles < 0)
         {
-            throw std::invalid_argument("outputRingName not specified");
+            throw std::invalid_argument("captureFiles is negative");
+        }
+        // Writing to a tank file takes the place of the output ring
+        outputFile
+            = propertyTree.get<std::string> ("outputFile",
+                                             outputFile.string());
+        outputRingName.clear();
+        if (outputFile.empty())
+        {
+            outputRingName
+                = propertyTree.get<std::string> ("outputRingName");
+            if (outputRingName.empty())
+            {
+                throw std::invalid_argument("outputRingName not specified");
+            }
         }
         auto logDirectoryName
             = propertyTree.get<std::string> ("logDirectory", logDirectory);
@@ -144,132 +255,123 @@ Allowed options)""");
             throw std::invalid_argument("Circular buffer duration is negative");
         }
 
-        verbosity = propertyTree.get<int> ("verbosity", verbosity);
-        verbosity = std::min(3, std::max(0, verbosity));
- 
-    }
-    std::string moduleName{"MOD_DEDUPLICATOR"};
-    std::string inputRingName{"TEMP_RING"};
-    std::string outputRingName{"WAVE_RING"};
-    std::filesystem::path logDirectory{"./logs"};
-    std::chrono::seconds maxFutureTime{0};
-    std::chrono::seconds maxPastTime{1200};
-    std::chrono::seconds logBadDataInterval{3600};
-    std::chrono::seconds circularBufferDuration{3600};
-    std::chrono::seconds heartbeatInterval{15};
-    int verbosity{2};
-    bool runProgram{true};
-};
+        warmStart = propertyTree.get<bool> ("warmStart", warmStart);
 
-struct TraceHeader
-{
-    TraceHeader() = default;
-    explicit TraceHeader(const Deduplicator::TraceBuf2 &traceBuf2) 
-    {
-        auto network = traceBuf2.getNetwork();
-        auto station = traceBuf2.getStation(); 
-        auto channel = traceBuf2.getChannel();
-        std::string locationCode;
-        try
+        snapshotFile
+            = propertyTree.get<std::string> ("snapshotFile",
+                                             snapshotFile.string());
+        time
+            = propertyTree.get<int> ("snapshotInterval",
+                                 static_cast<int> (snapshotInterval.count()));
+        snapshotInterval = std::chrono::seconds {time};
+        if (snapshotInterval <= std::chrono::seconds {0})
         {
-            locationCode = traceBuf2.getLocationCode();
+            throw std::invalid_argument("Snapshot interval must be positive");
         }
-        catch (...)
+
+        memoryBudget
+            = propertyTree.get<int> ("memoryBudget", memoryBudget);
+        if (memoryBudget < 0)
         {
+            throw std::invalid_argument("Memory budget is negative");
         }
-        // Trace name
-        name = network + "."  + station + "." + channel;
-        if (!locationCode.empty())
+
+        verbosity = propertyTree.get<int> ("verbosity", verbosity);
+        verbosity = std::min(3, std::max(0, verbosity));
+
+        // Threaded pipeline
+        pipelined = propertyTree.get<bool> ("pipelined", pipelined);
+        numberOfBatches
+            = propertyTree.get<int> ("numberOfBatches", numberOfBatches);
+        if (numberOfBatches < 1)
         {
-            name = name + "." + locationCode;
+            throw std::invalid_argument("numberOfBatches must be positive");
         }
-        auto iStartTime
-            = static_cast<int64_t>
-              (std::round(traceBuf2.getStartTime()*1000000));
-        startTime = std::chrono::microseconds {iStartTime}; 
-        samplingRate
-            = static_cast<int> (std::round(traceBuf2.getSamplingRate()));
-        try
+        readerCPUs.clear();
+        for (const auto &cpu :
+             splitList(propertyTree.get<std::string> ("readerCPU", "")))
         {
-            nSamples = traceBuf2.getNumberOfSamples();
+            readerCPUs.push_back(std::stoi(cpu));
         }
-        catch (...)
+        engineCPU = propertyTree.get<int> ("engineCPU", engineCPU);
+        numberOfEngineThreads
+            = propertyTree.get<int> ("numberOfEngineThreads",
+                                     numberOfEngineThreads);
+        if (numberOfEngineThreads < 1)
         {
+            throw std::invalid_argument(
+                "numberOfEngineThreads must be positive");
         }
-    }
-    bool operator<(const TraceHeader &rhs) const
-    {
-        return startTime < rhs.startTime;
-    } 
-    bool operator>(const TraceHeader &rhs) const
-    {
-        return startTime > rhs.startTime;
-    }
-    bool operator==(const TraceHeader &rhs) const
-    {
-        if (rhs.name != name){return false;}
-        if (rhs.samplingRate - samplingRate != 0)
+        writerCPU = propertyTree.get<int> ("writerCPU", writerCPU);
+        time
+            = propertyTree.get<int> ("logStatisticsInterval",
+                              static_cast<int> (logStatisticsInterval.count()));
+        logStatisticsInterval = std::chrono::seconds {time};
+
+        // Polling
+        auto strategy
+            = propertyTree.get<std::string> ("pollingStrategy", "backoff");
+        std::transform(strategy.begin(), strategy.end(), strategy.begin(),
+                       ::tolower);
+        if (strategy == "busyspin")
         {
-            spdlog::get("deduplicator")->warn("Inconsistent samplign rates for: "
-                                             + name);
-            return false;
+            pollingMode = Deduplicator::PollingStrategy::Mode::BusySpin;
         }
-        auto dStartTime = (rhs.startTime.count() - startTime.count());
-        if (samplingRate < 105)
+        else if (strategy == "backoff")
         {
-            return (dStartTime < std::chrono::microseconds {15000}.count());
+            pollingMode = Deduplicator::PollingStrategy::Mode::Backoff;
         }
-        else if (samplingRate < 255)
+        else if (strategy == "latencytarget")
         {
-            return (dStartTime < std::chrono::microseconds {4500}.count());
+            pollingMode = Deduplicator::PollingStrategy::Mode::LatencyTarget;
         }
-        else if (samplingRate < 505)
+        else
         {
-            return (dStartTime < std::chrono::microseconds {2500}.count());
+            throw std::invalid_argument("Unhandled polling strategy: "
+                                      + strategy);
         }
-        else if (samplingRate < 1005)
+        time
+            = propertyTree.get<int> ("maxAddedLatency",
+                                     static_cast<int> (maxAddedLatency.count()));
+        maxAddedLatency = std::chrono::milliseconds {time};
+        if (maxAddedLatency < std::chrono::milliseconds {0})
         {
-            return (dStartTime < std::chrono::microseconds {1500}.count());
+            throw std::invalid_argument("Max added latency is negative");
         }
-        spdlog::get("deduplicator")->critical(
-            "Could not classify sampling rate: "
-          + std::to_string(samplingRate));
-        return false;
-    } 
-    std::string name;
-    std::chrono::microseconds startTime{0};
-    int samplingRate{100};
-    int nSamples{0};
-};
-
-int estimateCapacity(const TraceHeader &header,
-                     const std::chrono::seconds &memory)
-{
-    auto duration
-        = std::max(0.0,
-                   std::round( (header.nSamples - 1.)
-                               /std::max(1, header.samplingRate)));
-    std::chrono::seconds packetDuration{static_cast<int> (duration)};
-    return std::max(1000, static_cast<int> (memory.count()/duration)) + 1;
-}
-
-bool operator<(const TraceHeader &lhs, const TraceHeader &rhs)
-{
-    return lhs.startTime < rhs.startTime;
-}
-
-std::string toName(const Deduplicator::TraceBuf2 &traceBuf2Message)
-{
-    auto traceName = traceBuf2Message.getNetwork() + "." 
-                   + traceBuf2Message.getStation() + "." 
-                   + traceBuf2Message.getChannel();
-    auto locationCode = traceBuf2Message.getLocationCode();
-    if (!locationCode.empty())
-    {
-         traceName = traceName + "." + locationCode;
+ 
     }
-    return traceName;
-}
+    std::string moduleName{"MOD_DEDUPLICATOR"};
+    std::vector<std::string> inputRingNames{"TEMP_RING"};
+    std::vector<int> readerCPUs;
+    std::string outputRingName{"WAVE_RING"};
+    std::vector<std::filesystem::path> replayFiles;
+    std::filesystem::path outputFile;
+    std::filesystem::path captureDirectory;
+    std::filesystem::path logDirectory{"./logs"};
+    std::chrono::seconds maxFutureTime{0};
+    std::chrono::seconds maxPastTime{1200};
+    std::chrono::seconds logBadDataInterval{3600};
+    std::chrono::seconds circularBufferDuration{3600};
+    std::chrono::seconds snapshotInterval{60};
+    std::filesystem::path snapshotFile;
+    std::chrono::seconds heartbeatInterval{15};
+    std::chrono::seconds logStatisticsInterval{60};
+    std::chrono::milliseconds maxAddedLatency{50};
+    double replaySpeed{0};
+    Deduplicator::PollingStrategy::Mode pollingMode{
+        Deduplicator::PollingStrategy::Mode::Backoff};
+    int verbosity{2};
+    int numberOfBatches{8};
+    int numberOfEngineThreads{1};
+    int memoryBudget{0}; // MB
+    int captureFileSize{256}; // MB
+    int captureFiles{8};
+    int engineCPU{-1};
+    int writerCPU{-1};
+    bool pipelined{false};
+    bool warmStart{false};
+    bool runProgram{true};
+};
 
 int main(int argc, char *argv[])
 {
@@ -305,8 +407,31 @@ int main(int argc, char *argv[])
     }
     logger->info("Version: " + Deduplicator::Version::getVersion());
     logger->info("Module Identifier: " + options.moduleName);
-    logger->info("Input ring: " + options.inputRingName);
-    logger->info("Output ring: " + options.outputRingName);
+    for (const auto &inputRingName : options.inputRingNames)
+    {
+        logger->info("Input ring: " + inputRingName);
+    }
+    for (const auto &replayFile : options.replayFiles)
+    {
+        logger->info("Replay file: " + replayFile.string());
+    }
+    if (!options.replayFiles.empty())
+    {
+        logger->info("Replay speed: " + std::to_string(options.replaySpeed));
+    }
+    if (!options.captureDirectory.empty())
+    {
+        logger->info("Capturing input rings to: "
+                   + options.captureDirectory.string());
+    }
+    if (options.outputFile.empty())
+    {
+        logger->info("Output ring: " + options.outputRingName);
+    }
+    else
+    {
+        logger->info("Output file: " + options.outputFile.string());
+    }
     logger->info("Log directory: " + options.logDirectory.string());
     logger->info("Maximum future time: "
                + std::to_string(options.maxFutureTime.count()) + " seconds");
@@ -315,19 +440,73 @@ int main(int argc, char *argv[])
     logger->info("Log bad data interval: "
                + std::to_string(options.logBadDataInterval.count())
                + " seconds");
-    logger->info("Approximate circular buffer duration: " 
+    logger->info("Circular buffer duration: "
                + std::to_string(options.circularBufferDuration.count())
                + " seconds");
+    if (!options.snapshotFile.empty())
+    {
+        logger->info("Snapshot file: " + options.snapshotFile.string()
+                   + " saved every "
+                   + std::to_string(options.snapshotInterval.count())
+                   + " seconds");
+    }
+    if (options.memoryBudget > 0)
+    {
+        logger->info("Memory budget: "
+                   + std::to_string(options.memoryBudget) + " MB");
+    }
     logger->info("Approximate heartbeat interval: "
                + std::to_string(options.heartbeatInterval.count()) + " seconds");
+    logger->info("Maximum added latency: "
+               + std::to_string(options.maxAddedLatency.count())
+               + " milliseconds");
+    // Each input ring needs its own reader thread
+    if (options.inputRingNames.size() > 1 && !options.pipelined)
+    {
+        logger->info("Multiple input rings require the pipelined mode");
+        options.pipelined = true;
+    }
+    if (options.pipelined)
+    {
+        logger->info("Running pipelined with "
+                   + std::to_string(options.numberOfBatches) + " batches");
+    }
 
-
-    // Create the rings
-    Deduplicator::WaveRing inputWaveRing;
+    // Connect to the input rings first.  Their clock, which is the replay's
+    // clock when replaying files, judges the snapshot and warm start.
+    std::vector<std::unique_ptr<Deduplicator::IWaveRing>> inputRings;
     try
     {
-        inputWaveRing.connect(options.inputRingName);
-        inputWaveRing.flush();
+        if (!options.replayFiles.empty())
+        {
+            // The replay runs on its own clock so the history and time
+            // window are judged against the recorded data
+            auto inputFileRing = std::make_unique<Deduplicator::FileRing> ();
+            inputFileRing->open(options.replayFiles);
+            inputFileRing->setReplaySpeed(options.replaySpeed);
+            inputFileRing->setTimeWindow(options.maxPastTime,
+                                         options.maxFutureTime);
+            inputRings.push_back(std::move(inputFileRing));
+        }
+        for (const auto &inputRingName : options.inputRingNames)
+        {
+            auto inputWaveRing = std::make_unique<Deduplicator::WaveRing> ();
+            inputWaveRing->connect(inputRingName);
+            // Drop expired and future packets before they are unpacked
+            inputWaveRing->setTimeWindow(options.maxPastTime,
+                                         options.maxFutureTime);
+            if (!options.captureDirectory.empty())
+            {
+                auto recorder
+                    = std::make_unique<Deduplicator::CaptureRecorder> ();
+                recorder->setMaximumFileSize(
+                    static_cast<size_t> (options.captureFileSize)*1024*1024);
+                recorder->setMaximumNumberOfFiles(options.captureFiles);
+                recorder->start(options.captureDirectory, inputRingName);
+                inputWaveRing->setCaptureRecorder(std::move(recorder));
+            }
+            inputRings.push_back(std::move(inputWaveRing));
+        }
     }
     catch (const std::exception &e)
     {
@@ -335,13 +514,73 @@ int main(int argc, char *argv[])
         logger->critical(e.what());
         return EXIT_FAILURE;
     }
-    Deduplicator::WaveRing outputWaveRing; 
+    auto startTime = inputRings.at(0)->getNow();
+
+    // Create the engine and pick up where the last run left off
+    Deduplicator::ShardedEngine engine{options.numberOfEngineThreads};
+    engine.setMaximumPastTime(options.maxPastTime);
+    engine.setMaximumFutureTime(options.maxFutureTime);
+    engine.setCircularBufferDuration(options.circularBufferDuration);
+    engine.setMemoryBudget(static_cast<size_t> (options.memoryBudget)*1024*1024);
+    bool haveHistory{false};
+    if (!options.snapshotFile.empty() &&
+        std::filesystem::exists(options.snapshotFile))
+    {
+        try
+        {
+            auto loadStartTime = std::chrono::steady_clock::now();
+            auto nChannels = engine.loadSnapshot(options.snapshotFile,
+                                                 startTime);
+            auto loadDuration
+                = std::chrono::duration_cast<std::chrono::milliseconds>
+                  (std::chrono::steady_clock::now() - loadStartTime);
+            logger->info("Restored " + std::to_string(nChannels)
+                       + " channels from snapshot in "
+                       + std::to_string(loadDuration.count()) + " ms");
+            // A snapshot whose channels have all expired is no history
+            haveHistory = (nChannels > 0);
+        }
+        catch (const std::exception &e)
+        {
+            logger->warn("Could not load snapshot: "
+                       + std::string {e.what()});
+            engine.clear();
+        }
+    }
+
+    // Connect to the output ring.  It holds what we recently forwarded so
+    // optionally seed the histories with it rather than discard it.
+    std::unique_ptr<Deduplicator::IWaveRing> outputRing;
     try
     {
-        outputWaveRing.connect(options.outputRingName,
-                               options.moduleName);
-        outputWaveRing.flush();
-        outputWaveRing.writeHeartbeat(false);
+        if (!options.outputFile.empty())
+        {
+            auto outputFileRing = std::make_unique<Deduplicator::FileRing> ();
+            outputFileRing->create(options.outputFile);
+            outputRing = std::move(outputFileRing);
+        }
+        else
+        {
+            auto outputWaveRing = std::make_unique<Deduplicator::WaveRing> ();
+            outputWaveRing->connect(options.outputRingName,
+                                    options.moduleName);
+            if (options.warmStart)
+            {
+                outputWaveRing->read();
+                auto nSeeded
+                    = engine.seed(outputWaveRing->getTraceBuf2ViewsReference(),
+                                  startTime);
+                logger->info("Seeded " + std::to_string(nSeeded)
+                           + " packets from the output ring");
+                haveHistory = true;
+            }
+            else
+            {
+                outputWaveRing->flush();
+            }
+            outputRing = std::move(outputWaveRing);
+        }
+        outputRing->writeHeartbeat(false);
     }
     catch (const std::exception &e)
     {
@@ -349,19 +588,114 @@ int main(int argc, char *argv[])
         logger->critical(e.what());
         return EXIT_FAILURE;
     }
+    // With a history we can safely drain what arrived on the input rings
+    // while we were down; otherwise skip it lest we forward duplicates.
+    // A replay is never skipped.
+    if (!haveHistory && options.replayFiles.empty())
+    {
+        try
+        {
+            for (auto &inputRing : inputRings){inputRing->flush();}
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            logger->critical(e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    Deduplicator::PollingStrategy pollingStrategy;
+    pollingStrategy.setMode(options.pollingMode);
+    pollingStrategy.setMaximumAddedLatency(options.maxAddedLatency);
+    // Read, deduplicate, and write on separate threads
+    if (options.pipelined)
+    {
+        Deduplicator::Pipeline pipeline;
+        try
+        {
+            pipeline.setNumberOfBatches(options.numberOfBatches);
+            pipeline.setReaderCPUs(options.readerCPUs);
+            pipeline.setEngineCPU(options.engineCPU);
+            pipeline.setWriterCPU(options.writerCPU);
+            pipeline.setHeartbeatInterval(options.heartbeatInterval);
+            pipeline.setLogBadDataInterval(options.logBadDataInterval);
+            pipeline.setSnapshot(options.snapshotFile,
+                                 options.snapshotInterval);
+            pipeline.setPollingStrategy(pollingStrategy);
+            pipeline.initialize(std::move(inputRings),
+                                std::move(outputRing),
+                                std::move(engine));
+            pipeline.start();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            logger->critical(e.what());
+            return EXIT_FAILURE;
+        }
+        auto logStatisticsStartTime = std::chrono::high_resolution_clock::now();
+        while (pipeline.isRunning())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds {100});
+            auto now = std::chrono::high_resolution_clock::now();
+            if (now - logStatisticsStartTime > options.logStatisticsInterval &&
+                options.logStatisticsInterval.count() >= 0)
+            {
+                logger->info("Engine queue depth: "
+                  + std::to_string(pipeline.getEngineQueueDepth())
+                  + " (max " 
+                  + std::to_string(pipeline.getMaximumEngineQueueDepth())
+                  + "); Writer queue depth: "
+                  + std::to_string(pipeline.getWriterQueueDepth())
+                  + " (max "
+                  + std::to_string(pipeline.getMaximumWriterQueueDepth())
+                  + "); Reader stalls: "
+                  + std::to_string(pipeline.getNumberOfReaderStalls()));
+                logger->info("Added latency: mean "
+                  + std::to_string(pipeline.getMeanAddedLatency().count())
+                  + " us (max "
+                  + std::to_string(pipeline.getMaximumAddedLatency().count())
+                  + " us)");
+                auto writeSummary = pipeline.getWriteSummary();
+                logger->info("Wrote "
+                  + std::to_string(writeSummary.nWritten) + " packets ("
+                  + std::to_string(writeSummary.nFailed) + " failures) at "
+                  + std::to_string(static_cast<int64_t>
+                                   (writeSummary.getWriteRate()))
+                  + " packets/s");
+                pipeline.resetMaximumQueueDepths();
+                pipeline.resetAddedLatency();
+                pipeline.resetWriteSummary();
+                logStatisticsStartTime = now;
+            }
+        }
+        pipeline.stop();
+        return EXIT_SUCCESS;
+    }
+    auto &inputRing = *inputRings.at(0);
     auto heartbeatStartTime = std::chrono::high_resolution_clock::now();
     auto logBadDataStartTime = std::chrono::high_resolution_clock::now();
-    std::set<std::string> expiredChannels;  
-    std::set<std::string> futureChannels;
-    std::set<std::string> duplicateChannels;
-    std::map<std::string, boost::circular_buffer<::TraceHeader>> circularBuffers;
+    auto logStatisticsStartTime = std::chrono::high_resolution_clock::now();
+    auto snapshotStartTime = std::chrono::high_resolution_clock::now();
+    // A packet that lands on the ring just after a scrape waits until the
+    // next scrape is processed.  That is the latency we add.
+    auto previousScrapeEndTime = std::chrono::steady_clock::now();
+    std::chrono::microseconds maximumAddedLatency{0};
+    std::chrono::microseconds sumAddedLatency{0};
+    int64_t nAddedLatency{0};
+    int64_t nWritten{0};
+    int64_t nWriteFailures{0};
+    std::chrono::microseconds writeDuration{0};
+    std::vector<Deduplicator::Decision> decisions;
+    std::vector<Deduplicator::TraceBuf2View> acceptedMessages;
     while (true) //for (int i = 0; i < 1000; ++i)
     {
         // Begin by scraping everything off the ring
         logger->debug("Scraping ring...");
+        auto pollStartTime = std::chrono::steady_clock::now();
         try
         {
-            inputWaveRing.read();
+            inputRing.read();
         }
         catch (const Deduplicator::TerminateException &e)
         {
@@ -377,127 +711,72 @@ int main(int argc, char *argv[])
         // Computing the current time after the scraping the ring is
         // conservative.  Basically, this allows for a zero-latency,
         // 1 sample packet, to be successfully passed through.
+        auto scrapeEndTime = std::chrono::steady_clock::now();
         auto now = std::chrono::high_resolution_clock::now();
-        auto processingStartTime = now;
-        auto nowMuS
-            = std::chrono::time_point_cast<std::chrono::microseconds>
-              (now).time_since_epoch().count();
-        double nowSeconds = nowMuS*1.e-6;
-        double earliestTime = nowSeconds - options.maxPastTime.count();
-        double latestTime   = nowSeconds + options.maxFutureTime.count();
-        // Unpack ring
+        auto nowMuS = inputRing.getNow();
+        // Decide what to do with each packet
         const auto &traceBuf2Messages
-            = inputWaveRing.getTraceBuf2MessagesReference(); 
-        for (const auto &traceBuf2Message : traceBuf2Messages)
+            = inputRing.getTraceBuf2ViewsReference();
+        engine.process(traceBuf2Messages, nowMuS, &decisions);
+        const bool logDebug = logger->should_log(spdlog::level::debug);
+        acceptedMessages.clear();
+        for (size_t i = 0; i < traceBuf2Messages.size(); ++i)
         {
-            // Construct the trace header for the circular buffer
-            TraceHeader traceHeader;
-            try
-            {
-                traceHeader = std::move(TraceHeader{traceBuf2Message});
-            }
-            catch (const std::exception &e)
+            const auto &traceBuf2Message = traceBuf2Messages[i];
+            auto decision = decisions[i];
+            if (decision == Deduplicator::Decision::Invalid)
             {
-                logger->error("Failed to unpack traceBuf2.  Skipping...");
+                logger->error("Failed to unpack traceBuf2 for "
+                            + traceBuf2Message.getChannelKey().toName()
+                            + ".  Skipping...");
                 continue;
             }
-            
-            auto startTime = traceBuf2Message.getStartTime();
-            if (startTime < earliestTime)
+            if (decision != Deduplicator::Decision::Accept)
             {
-                logger->debug(traceHeader.name
-                          + "'s data has expired; skipping...");
-                if (!expiredChannels.contains(traceHeader.name))
+                if (logDebug)
                 {
-                    expiredChannels.insert(traceHeader.name);
-                }
-                continue;
-            }
-            auto endTime = traceBuf2Message.getEndTime();
-            if (endTime > latestTime)
-            {
-                logger->debug(traceHeader.name
-                          + "'s data is in future data; skipping...");
-                if (!futureChannels.contains(traceHeader.name))
-                {
-                    futureChannels.insert(traceHeader.name);
-                }
-                continue;
-            }
-            // Check for existance?
-            auto circularBufferIndex = circularBuffers.find(traceHeader.name);
-            bool firstExample{false};
-            if (circularBufferIndex == circularBuffers.end())
-            {
-                auto capacity
-                     = estimateCapacity(traceHeader,
-                                        options.circularBufferDuration);
-                logger->info("Creating new circular buffer for: "
-                           + traceHeader.name + " with capacity: "
-                           + std::to_string(capacity));
-                boost::circular_buffer<::TraceHeader> newCircularBuffer(capacity);
-                newCircularBuffer.push_back(traceHeader);
-                circularBuffers.insert(std::pair{traceHeader.name,
-                                                 std::move(newCircularBuffer)});
-                firstExample = true;
-            }
-            circularBufferIndex = circularBuffers.find(traceHeader.name);
-            if (circularBufferIndex == circularBuffers.end())
-            {
-                logger->critical("Algorithm error - cb doesn't exist for: "
-                               + traceHeader.name);
-                continue;
-            }
-            auto traceHeaderIndex
-                = std::find(circularBufferIndex->second.begin(),
-                            circularBufferIndex->second.end(),
-                            traceHeader);
-            if (traceHeaderIndex != circularBufferIndex->second.end())
-            {
-                if (!firstExample)
-                {
-                    logger->debug("Detected duplicate for: "
-                                + traceHeader.name);
-                    if (!duplicateChannels.contains(traceHeader.name))
+                    auto name = traceBuf2Message.getChannelKey().toName();
+                    if (decision == Deduplicator::Decision::Expired)
                     {
-                        duplicateChannels.insert(traceHeader.name);
+                        logger->debug(name + "'s data has expired; skipping...");
+                    }
+                    else if (decision == Deduplicator::Decision::Future)
+                    {
+                        logger->debug(name
+                                    + "'s data is in future data; skipping...");
+                    }
+                    else
+                    {
+                        logger->debug("Detected duplicate for: " + name);
                     }
-                    continue;
-                }
-                else
-                {
-                    logger->debug("Initial duplicate found for: "
-                                + traceHeader.name + "; everything is fine!");
                 }
+                continue;
             }
-            // Insert it (typically new stuff shows up)
-            if (traceHeader > circularBufferIndex->second.back())
-            {
-                logger->debug("Inserting " + traceHeader.name
-                            + " at end of cb");
-                circularBufferIndex->second.push_back(traceHeader);
-            }
-            else // This is slow but we'll do it
-            {
-                logger->debug("Inserting " + traceHeader.name
-                            + " in cb then sorting...");
-                circularBufferIndex->second.push_back(traceHeader);
-                std::sort(circularBufferIndex->second.begin(),
-                          circularBufferIndex->second.end());
-            }
-            // Write it back out
+            acceptedMessages.push_back(traceBuf2Message);
+        } // Loop on traces
+        // Write the accepted packets back out
+        if (!acceptedMessages.empty())
+        {
             try
             {
-                outputWaveRing.write(traceBuf2Message);
+                auto writeSummary = outputRing->writeBatch(acceptedMessages);
+                if (writeSummary.nFailed > 0)
+                {
+                    logger->warn("Failed to write "
+                               + std::to_string(writeSummary.nFailed)
+                               + " of "
+                               + std::to_string(acceptedMessages.size())
+                               + " packets to output ring");
+                }
+                nWritten = nWritten + writeSummary.nWritten;
+                nWriteFailures = nWriteFailures + writeSummary.nFailed;
+                writeDuration = writeDuration + writeSummary.duration;
             }
             catch (const std::exception &e)
             {
-                logger->warn("Failed to write " + traceHeader.name
-                           + " to output ring.  Failed with: "
-                           + std::string{e.what()});
-                continue;
+                logger->error(e.what());
             }
-        } // Loop on traces
+        }
         // Time for heartbeating
         auto heartbeatDuration
             = std::chrono::duration_cast<std::chrono::seconds>
@@ -506,7 +785,7 @@ int main(int argc, char *argv[])
         {
             try
             {
-                outputWaveRing.writeHeartbeat(false);
+                outputRing->writeHeartbeat(false);
             }
             catch (const std::exception &e)
             {
@@ -521,6 +800,9 @@ int main(int argc, char *argv[])
         if (logBadDataDuration > options.logBadDataInterval &&
             options.logBadDataInterval.count() >= 0)
         {
+            auto expiredChannels
+                = ::mergeChannels(engine.getExpiredChannels(),
+                                  inputRing.getExpiredChannels());
             if (!expiredChannels.empty())
             {
                 std::string message{"The following channels had expired data:"};
@@ -531,6 +813,9 @@ int main(int argc, char *argv[])
                 logger->info(message);
                 logger->flush();
             }
+            auto futureChannels
+                = ::mergeChannels(engine.getFutureChannels(),
+                                  inputRing.getFutureChannels());
             if (!futureChannels.empty())
             {
                 std::string message{"The following channels had future data:"};
@@ -541,6 +826,7 @@ int main(int argc, char *argv[])
                 logger->info(message);
                 logger->flush();
             } 
+            auto duplicateChannels = engine.getDuplicateChannels();
             if (!duplicateChannels.empty())
             {
                 std::string message{"The following channels had duplicate data:"};
@@ -551,24 +837,79 @@ int main(int argc, char *argv[])
                 logger->info(message);
                 logger->flush();
             }
+            logger->info("Tracking "
+                       + std::to_string(engine.getNumberOfActiveChannels())
+                       + " of "
+                       + std::to_string(engine.getNumberOfChannels())
+                       + " channels in "
+                       + std::to_string(engine.getMemoryUsage())
+                       + " bytes");
             // Reset for next interval
             logBadDataStartTime = now;
-            expiredChannels.clear();
-            futureChannels.clear();
-            duplicateChannels.clear();
-        }
-        // Don't want to slam the ring but also don't want to slow ourselves
-        // down too much under a heavy load.
-        auto processingEndTime = std::chrono::high_resolution_clock::now(); 
-        auto processingDuration
-            = std::chrono::duration_cast<std::chrono::milliseconds>
-              (processingStartTime - processingEndTime);
-        constexpr std::chrono::milliseconds oneSecond{1000};
-        if (processingDuration < oneSecond)
-        { 
-            std::this_thread::sleep_for(oneSecond - processingDuration);
+            engine.clearBadChannels();
+            inputRing.clearRejectedChannels();
+        }
+        // Measure the latency we added to this scrape's packets
+        const bool haveTraffic = !traceBuf2Messages.empty();
+        auto processingEndTime = std::chrono::steady_clock::now();
+        if (haveTraffic)
+        {
+            auto addedLatency
+                = std::chrono::duration_cast<std::chrono::microseconds>
+                  (processingEndTime - previousScrapeEndTime);
+            maximumAddedLatency = std::max(maximumAddedLatency, addedLatency);
+            sumAddedLatency = sumAddedLatency + addedLatency;
+            nAddedLatency = nAddedLatency + 1;
         }
+        previousScrapeEndTime = scrapeEndTime;
+        if (now - logStatisticsStartTime > options.logStatisticsInterval &&
+            options.logStatisticsInterval.count() >= 0)
+        {
+            if (nAddedLatency > 0)
+            {
+                logger->info("Added latency: mean "
+                  + std::to_string(sumAddedLatency.count()/nAddedLatency)
+                  + " us (max "
+                  + std::to_string(maximumAddedLatency.count())
+                  + " us)");
+            }
+            if (nWritten + nWriteFailures > 0)
+            {
+                logger->info("Wrote " + std::to_string(nWritten)
+                           + " packets ("
+                           + std::to_string(nWriteFailures)
+                           + " failures) at "
+                           + std::to_string(static_cast<int64_t>
+                                 (nWritten/std::max(1.e-6,
+                                                    writeDuration.count()*1.e-6)))
+                           + " packets/s");
+            }
+            nWritten = 0;
+            nWriteFailures = 0;
+            writeDuration = std::chrono::microseconds {0};
+            maximumAddedLatency = std::chrono::microseconds {0};
+            sumAddedLatency = std::chrono::microseconds {0};
+            nAddedLatency = 0;
+            logStatisticsStartTime = now;
+        }
+        // Time for a checkpoint?
+        if (!options.snapshotFile.empty() &&
+            now - snapshotStartTime > options.snapshotInterval)
+        {
+            ::saveSnapshot(engine, options.snapshotFile, inputRing.getNow());
+            snapshotStartTime = now;
+        }
+        // Don't want to slam the ring but also don't want to add much
+        // latency.
+        auto pollDuration
+            = std::chrono::duration_cast<std::chrono::microseconds>
+              (processingEndTime - pollStartTime);
+        pollingStrategy.wait(haveTraffic, pollDuration);
+    }
+    if (!options.snapshotFile.empty())
+    {
+        ::saveSnapshot(engine, options.snapshotFile, inputRing.getNow());
     }
-    outputWaveRing.writeHeartbeat(true);
+    outputRing->writeHeartbeat(true);
     return EXIT_SUCCESS;
 }
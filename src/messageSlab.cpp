@@ -0,0 +1,104 @@
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include <deduplicator/messageSlab.hpp>
+
+using namespace Deduplicator;
+
+/// Reserve space
+void MessageSlab::reserve(const size_t nBytes, const int nMessages)
+{
+    if (nBytes > mBuffer.size()){mBuffer.resize(nBytes);}
+    if (nMessages > 0)
+    {
+        mOffsets.reserve(nMessages + 1);
+        mTypes.reserve(nMessages);
+    }
+}
+
+/// Get space for the next message
+char *MessageSlab::beginMessage(const size_t maximumLength)
+{
+    auto offset = mOffsets.back();
+    auto required = offset + maximumLength;
+    if (required > mBuffer.size())
+    {
+        // Grow geometrically so a busy ring settles after a few scrapes
+        mBuffer.resize(std::max(required, 2*mBuffer.size()));
+    }
+    mPending = maximumLength;
+    return mBuffer.data() + offset;
+}
+
+/// Commit the message
+void MessageSlab::commitMessage(const size_t length, const unsigned char type)
+{
+    if (length > mPending)
+    {
+        throw std::invalid_argument("Message length = "
+                                  + std::to_string(length)
+                                  + " exceeds reserved space = "
+                                  + std::to_string(mPending));
+    }
+    mOffsets.push_back(mOffsets.back() + length);
+    mTypes.push_back(type);
+    mPending = 0;
+}
+
+/// Number of messages
+int MessageSlab::size() const noexcept
+{
+    return static_cast<int> (mTypes.size());
+}
+
+bool MessageSlab::empty() const noexcept
+{
+    return mTypes.empty();
+}
+
+/// Get the message
+std::span<const char> MessageSlab::getMessage(const int index) const noexcept
+{
+#ifndef NDEBUG
+    assert(index >= 0 && index < size());
+#endif
+    return std::span<const char> {mBuffer.data() + mOffsets[index],
+                                  mOffsets[index + 1] - mOffsets[index]};
+}
+
+unsigned char MessageSlab::getMessageType(const int index) const noexcept
+{
+#ifndef NDEBUG
+    assert(index >= 0 && index < size());
+#endif
+    return mTypes[index];
+}
+
+/// Memory usage
+size_t MessageSlab::getNumberOfBytes() const noexcept
+{
+    return mOffsets.back();
+}
+
+size_t MessageSlab::getCapacity() const noexcept
+{
+    return mBuffer.size();
+}
+
+/// Reset
+void MessageSlab::clear() noexcept
+{
+    mOffsets.resize(1);
+    mTypes.clear();
+    mPending = 0;
+}
+
+void MessageSlab::release() noexcept
+{
+    clear();
+    mBuffer.clear();
+    mBuffer.shrink_to_fit();
+    mOffsets.shrink_to_fit();
+    mTypes.shrink_to_fit();
+}
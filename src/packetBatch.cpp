@@ -0,0 +1,238 @@
+#include <vector>
+#include <array>
+#include <cstring>
+#include <deduplicator/packetBatch.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/channelInterner.hpp>
+#include "traceBuf2Layout.hpp"
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DEDUPLICATOR_HAVE_AVX2_PATH
+#include <immintrin.h>
+#endif
+
+using namespace Deduplicator;
+
+namespace
+{
+
+void computeTimeMasksScalar(const int64_t *startTimes,
+                            const int64_t *endTimes,
+                            const size_t n,
+                            const int64_t earliestTime,
+                            const int64_t latestTime,
+                            uint8_t *expired,
+                            uint8_t *future) noexcept
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        expired[i] = startTimes[i] < earliestTime ? 1 : 0;
+        future[i] = endTimes[i] > latestTime ? 1 : 0;
+    }
+}
+
+#ifdef DEDUPLICATOR_HAVE_AVX2_PATH
+/// Expands a 4 bit compare mask into 4 bytes of 0 or 1
+constexpr std::array<uint32_t, 16> createMaskTable()
+{
+    std::array<uint32_t, 16> table{};
+    for (uint32_t bits = 0; bits < 16; ++bits)
+    {
+        uint32_t bytes = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            if ((bits >> k) & 1){bytes = bytes | (1u << (8*k));}
+        }
+        table[bits] = bytes;
+    }
+    return table;
+}
+// The table is laid out for a little-endian store
+constexpr std::array<uint32_t, 16> MASK_TABLE{createMaskTable()};
+
+/// Only this function is compiled for AVX2 so the library still runs on
+/// processors without it.
+__attribute__((target("avx2")))
+void computeTimeMasksAVX2(const int64_t *startTimes,
+                          const int64_t *endTimes,
+                          const size_t n,
+                          const int64_t earliestTime,
+                          const int64_t latestTime,
+                          uint8_t *expired,
+                          uint8_t *future) noexcept
+{
+    const auto earliest = _mm256_set1_epi64x(earliestTime);
+    const auto latest = _mm256_set1_epi64x(latestTime);
+    size_t i = 0;
+    for (; i + 4 <= n; i = i + 4)
+    {
+        auto start = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *> (startTimes + i));
+        auto end = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *> (endTimes + i));
+        // start < earliest and end > latest.  The sign bit of each lane
+        // becomes a bit of the mask.
+        auto expiredBits
+            = _mm256_movemask_pd(_mm256_castsi256_pd(
+                  _mm256_cmpgt_epi64(earliest, start)));
+        auto futureBits
+            = _mm256_movemask_pd(_mm256_castsi256_pd(
+                  _mm256_cmpgt_epi64(end, latest)));
+        std::memcpy(expired + i, &MASK_TABLE[expiredBits], 4);
+        std::memcpy(future + i, &MASK_TABLE[futureBits], 4);
+    }
+    ::computeTimeMasksScalar(startTimes + i, endTimes + i, n - i,
+                             earliestTime, latestTime,
+                             expired + i, future + i);
+}
+
+bool checkAVX2() noexcept
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+}
+
+/// Unpack the headers
+void PacketBatch::set(const std::span<const TraceBuf2View> packets,
+                      ChannelInterner *channels)
+{
+    auto n = packets.size();
+    mStartTimes.resize(n);
+    mEndTimes.resize(n);
+    mSamplingRates.resize(n);
+    mNumberOfSamples.resize(n);
+    mChannelIdentifiers.resize(n);
+    mValid.resize(n);
+    mExpired.resize(n);
+    mFuture.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const auto &packet = packets[i];
+        mExpired[i] = 0;
+        mFuture[i] = 0;
+        // A default constructed view has nothing to read
+        if (!packet.haveMessage())
+        {
+            mChannelIdentifiers[i] = -1;
+            mStartTimes[i] = 0;
+            mEndTimes[i] = 0;
+            mSamplingRates[i] = 0;
+            mNumberOfSamples[i] = 0;
+            mValid[i] = 0;
+            continue;
+        }
+        mChannelIdentifiers[i]
+            = channels != nullptr ? channels->intern(packet.getChannelKey()) :
+                                    -1;
+        // The view already checked the data type so read the header
+        // directly rather than through the getters
+        auto times
+            = TraceBuf2Layout::unpackTimes(packet.getNativePacketPointer());
+        mStartTimes[i] = times.startTime;
+        mEndTimes[i] = times.endTime;
+        mSamplingRates[i] = times.valid ? times.samplingRate : 0;
+        mNumberOfSamples[i] = times.nSamples;
+        mValid[i] = times.valid ? 1 : 0;
+    }
+}
+
+/// Masks
+void PacketBatch::computeTimeMasks(
+    const std::chrono::microseconds &earliestTime,
+    const std::chrono::microseconds &latestTime,
+    const bool vectorize) noexcept
+{
+#ifdef DEDUPLICATOR_HAVE_AVX2_PATH
+    if (vectorize && haveAVX2())
+    {
+        ::computeTimeMasksAVX2(mStartTimes.data(), mEndTimes.data(),
+                               mStartTimes.size(),
+                               earliestTime.count(), latestTime.count(),
+                               mExpired.data(), mFuture.data());
+        return;
+    }
+#endif
+    ::computeTimeMasksScalar(mStartTimes.data(), mEndTimes.data(),
+                             mStartTimes.size(),
+                             earliestTime.count(), latestTime.count(),
+                             mExpired.data(), mFuture.data());
+}
+
+bool PacketBatch::haveAVX2() noexcept
+{
+#ifdef DEDUPLICATOR_HAVE_AVX2_PATH
+    static const bool haveAVX2{::checkAVX2()};
+    return haveAVX2;
+#else
+    return false;
+#endif
+}
+
+/// Size
+int PacketBatch::size() const noexcept
+{
+    return static_cast<int> (mStartTimes.size());
+}
+
+bool PacketBatch::empty() const noexcept
+{
+    return mStartTimes.empty();
+}
+
+/// Fields
+std::span<const int64_t> PacketBatch::getStartTimes() const noexcept
+{
+    return mStartTimes;
+}
+
+std::span<const int64_t> PacketBatch::getEndTimes() const noexcept
+{
+    return mEndTimes;
+}
+
+std::span<const double> PacketBatch::getSamplingRates() const noexcept
+{
+    return mSamplingRates;
+}
+
+std::span<const int> PacketBatch::getNumberOfSamples() const noexcept
+{
+    return mNumberOfSamples;
+}
+
+std::span<const int> PacketBatch::getChannelIdentifiers() const noexcept
+{
+    return mChannelIdentifiers;
+}
+
+/// Masks
+std::span<const uint8_t> PacketBatch::getValidMask() const noexcept
+{
+    return mValid;
+}
+
+std::span<const uint8_t> PacketBatch::getExpiredMask() const noexcept
+{
+    return mExpired;
+}
+
+std::span<const uint8_t> PacketBatch::getFutureMask() const noexcept
+{
+    return mFuture;
+}
+
+/// Clear
+void PacketBatch::clear() noexcept
+{
+    mStartTimes.clear();
+    mEndTimes.clear();
+    mSamplingRates.clear();
+    mNumberOfSamples.clear();
+    mChannelIdentifiers.clear();
+    mValid.clear();
+    mExpired.clear();
+    mFuture.clear();
+}
@@ -0,0 +1,747 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+#include <spdlog/spdlog.h>
+#include <deduplicator/pipeline.hpp>
+#include <deduplicator/iWaveRing.hpp>
+#include <deduplicator/engine.hpp>
+#include <deduplicator/shardedEngine.hpp>
+#include <deduplicator/messageSlab.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/spscQueue.hpp>
+#include <deduplicator/pollingStrategy.hpp>
+
+using namespace Deduplicator;
+
+namespace
+{
+
+/// How long a stage waits before looking at its queue again.
+constexpr std::chrono::milliseconds STAGE_WAIT{1};
+
+/// One scrape of the input ring as it moves through the pipeline.
+struct Batch
+{
+    MessageSlab messageSlab;
+    std::vector<TraceBuf2View> traceBuf2Views;
+    std::vector<Decision> decisions;
+    std::chrono::microseconds now{0};
+    /// When the scrape before this one ended.  A packet that landed on the
+    /// ring just after that waited until this batch was written.
+    std::chrono::steady_clock::time_point previousScrapeEndTime;
+    /// The index of the reader that owns this batch
+    int source{0};
+};
+
+/// Scrapes one input ring.  The writer returns this reader's batches to its
+/// free queue and the engine takes them from its engine queue so every
+/// queue keeps exactly one producer and one consumer.
+struct Reader
+{
+    std::unique_ptr<IWaveRing> ring;
+    PollingStrategy pollingStrategy;
+    std::unique_ptr<SpscQueue<Batch *>> freeQueue;
+    std::unique_ptr<SpscQueue<Batch *>> engineQueue;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    int cpu{-1};
+};
+
+void pinThread(std::thread &thread, const int cpu, const std::string &name)
+{
+    if (cpu < 0){return;}
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    auto returnCode = pthread_setaffinity_np(thread.native_handle(),
+                                             sizeof(cpu_set_t), &cpuSet);
+    if (returnCode != 0)
+    {
+        spdlog::get("deduplicator")->warn("Failed to pin " + name
+                                        + " thread to CPU "
+                                        + std::to_string(cpu));
+    }
+    else
+    {
+        spdlog::get("deduplicator")->info("Pinned " + name + " thread to CPU "
+                                        + std::to_string(cpu));
+    }
+}
+
+template<typename T>
+void updateMaximum(std::atomic<T> &maximum, const T value) noexcept
+{
+    auto current = maximum.load(std::memory_order_relaxed);
+    while (value > current &&
+           !maximum.compare_exchange_weak(current, value,
+                                          std::memory_order_relaxed))
+    {
+    }
+}
+
+void logChannels(const std::string &header,
+                 const std::vector<std::string> &channels)
+{
+    if (channels.empty()){return;}
+    auto logger = spdlog::get("deduplicator");
+    std::string message{header};
+    for (const auto &channel : channels)
+    {
+        message = message + " " + channel;
+    }
+    logger->info(message);
+    logger->flush();
+}
+
+}
+
+class Pipeline::PipelineImpl
+{
+public:
+    /// Scrapes an input ring into free batches
+    void read(Reader *reader)
+    {
+        auto logger = spdlog::get("deduplicator");
+        auto &ring = *reader->ring;
+        auto &freeQueue = *reader->freeQueue;
+        auto &engineQueue = *reader->engineQueue;
+        Batch *batch{nullptr};
+        bool stalled{false};
+        auto previousScrapeEndTime = std::chrono::steady_clock::now();
+        auto logBadDataStartTime = std::chrono::high_resolution_clock::now();
+        while (mKeepRunning.load(std::memory_order_relaxed))
+        {
+            if (batch == nullptr)
+            {
+                // Every batch is in flight so the writer is behind
+                if (!freeQueue.tryPop(&batch))
+                {
+                    if (!stalled)
+                    {
+                        mReaderStalls.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    stalled = true;
+                    std::this_thread::sleep_for(STAGE_WAIT);
+                    continue;
+                }
+                stalled = false;
+            }
+            auto pollStartTime = std::chrono::steady_clock::now();
+            try
+            {
+                ring.read(&batch->messageSlab, &batch->traceBuf2Views);
+            }
+            catch (const TerminateException &e)
+            {
+                logger->info("Received terminate exception from ring: "
+                           + std::string {e.what()});
+                // Shut everything down
+                mKeepRunning.store(false, std::memory_order_relaxed);
+                break;
+            }
+            catch (const std::exception &e)
+            {
+                logger->error(e.what());
+                continue;
+            }
+            auto scrapeEndTime = std::chrono::steady_clock::now();
+            // The ring belongs to this thread so report what it rejected
+            // from here
+            if (ring.haveTimeWindow() && mLogBadDataInterval.count() >= 0)
+            {
+                auto now = std::chrono::high_resolution_clock::now();
+                if (now - logBadDataStartTime > mLogBadDataInterval)
+                {
+                    ::logChannels("The following channels had expired data:",
+                                  ring.getExpiredChannels());
+                    ::logChannels("The following channels had future data:",
+                                  ring.getFutureChannels());
+                    ring.clearRejectedChannels();
+                    logBadDataStartTime = now;
+                }
+            }
+            const bool haveTraffic = !batch->traceBuf2Views.empty();
+            batch->previousScrapeEndTime = previousScrapeEndTime;
+            previousScrapeEndTime = scrapeEndTime;
+            auto pollDuration
+                = std::chrono::duration_cast<std::chrono::microseconds>
+                  (scrapeEndTime - pollStartTime);
+            if (!haveTraffic)
+            {
+                reader->pollingStrategy.wait(haveTraffic, pollDuration);
+                continue;
+            }
+            // Computing the current time after the scraping the ring is
+            // conservative.  The ring owns the clock so a replay is judged
+            // on its own time.
+            batch->now = ring.getNow();
+            // The engine queue holds every batch so this cannot fail
+            while (!engineQueue.tryPush(std::move(batch)))
+            {
+                std::this_thread::sleep_for(STAGE_WAIT);
+            }
+            ::updateMaximum(mMaximumEngineQueueDepth, engineQueue.size());
+            batch = nullptr;
+            // Hand off the packets before waiting so the wait does not add
+            // to their latency
+            reader->pollingStrategy.wait(haveTraffic, pollDuration);
+        }
+        reader->running.store(false, std::memory_order_release);
+    }
+    /// Deduplicates the batches
+    void process()
+    {
+        auto logBadDataStartTime = std::chrono::high_resolution_clock::now();
+        auto snapshotStartTime = logBadDataStartTime;
+        // The checkpoints are on the clock the packets were judged against
+        auto batchNow = mStartTime;
+        Batch *batch{nullptr};
+        auto nReaders = static_cast<int> (mReaders.size());
+        int nextReader = 0;
+        while (true)
+        {
+            // Take turns with the readers so that one busy ring cannot
+            // starve the others
+            bool haveBatch{false};
+            for (int i = 0; i < nReaders; ++i)
+            {
+                auto &reader = *mReaders[nextReader];
+                nextReader = (nextReader + 1)%nReaders;
+                if (reader.engineQueue->tryPop(&batch))
+                {
+                    haveBatch = true;
+                    break;
+                }
+            }
+            if (!haveBatch)
+            {
+                bool done{true};
+                for (const auto &reader : mReaders)
+                {
+                    if (reader->running.load(std::memory_order_acquire) ||
+                        !reader->engineQueue->empty())
+                    {
+                        done = false;
+                        break;
+                    }
+                }
+                if (done){break;}
+                std::this_thread::sleep_for(STAGE_WAIT);
+                continue;
+            }
+            batchNow = batch->now;
+            mEngine.process(batch->traceBuf2Views, batch->now,
+                            batch->source, &batch->decisions);
+            while (!mWriterQueue->tryPush(std::move(batch)))
+            {
+                std::this_thread::sleep_for(STAGE_WAIT);
+            }
+            ::updateMaximum(mMaximumWriterQueueDepth, mWriterQueue->size());
+            // Time for logging?
+            auto now = std::chrono::high_resolution_clock::now();
+            auto logBadDataDuration
+                = std::chrono::duration_cast<std::chrono::seconds>
+                  (now - logBadDataStartTime);
+            if (logBadDataDuration > mLogBadDataInterval &&
+                mLogBadDataInterval.count() >= 0)
+            {
+                ::logChannels("The following channels had expired data:",
+                              mEngine.getExpiredChannels());
+                ::logChannels("The following channels had future data:",
+                              mEngine.getFutureChannels());
+                ::logChannels("The following channels had duplicate data:",
+                              mEngine.getDuplicateChannels());
+                if (nReaders > 1){logFirstDeliveries();}
+                spdlog::get("deduplicator")->info("Tracking "
+                  + std::to_string(mEngine.getNumberOfActiveChannels())
+                  + " of "
+                  + std::to_string(mEngine.getNumberOfChannels())
+                  + " channels in "
+                  + std::to_string(mEngine.getMemoryUsage()) + " bytes");
+                // Reset for next interval
+                logBadDataStartTime = now;
+                mEngine.clearBadChannels();
+                mEngine.clearFirstDeliveries();
+            }
+            // Time for a checkpoint?
+            if (!mSnapshotFile.empty() &&
+                now - snapshotStartTime > mSnapshotInterval)
+            {
+                saveSnapshot(batchNow);
+                snapshotStartTime = now;
+            }
+        }
+        if (!mSnapshotFile.empty()){saveSnapshot(batchNow);}
+        mEngineRunning.store(false, std::memory_order_release);
+    }
+    /// Checkpoints the engine
+    void saveSnapshot(const std::chrono::microseconds &now)
+    {
+        try
+        {
+            mEngine.saveSnapshot(mSnapshotFile, now);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::get("deduplicator")->warn("Failed to save snapshot: "
+                                            + std::string {e.what()});
+        }
+    }
+    /// Logs which input ring delivered each channel first
+    void logFirstDeliveries()
+    {
+        auto firstDeliveries = mEngine.getFirstDeliveries();
+        if (firstDeliveries.empty()){return;}
+        auto nReaders = static_cast<int> (mReaders.size());
+        std::vector<int64_t> totals(nReaders, 0);
+        std::string message{"First deliveries by channel:"};
+        for (const auto &[name, counts] : firstDeliveries)
+        {
+            message = message + " " + name + "(";
+            for (int i = 0; i < static_cast<int> (counts.size()); ++i)
+            {
+                if (i > 0){message = message + ",";}
+                message = message + mRingNames.at(i) + ":"
+                        + std::to_string(counts[i]);
+                totals.at(i) = totals.at(i) + counts[i];
+            }
+            message = message + ")";
+        }
+        auto logger = spdlog::get("deduplicator");
+        logger->info(message);
+        std::string summary{"First deliveries by ring:"};
+        for (int i = 0; i < nReaders; ++i)
+        {
+            summary = summary + " " + mRingNames[i] + ":"
+                    + std::to_string(totals[i]);
+        }
+        logger->info(summary);
+        logger->flush();
+    }
+    /// Writes the accepted packets and returns the batches to the reader
+    void write()
+    {
+        auto logger = spdlog::get("deduplicator");
+        auto heartbeatStartTime = std::chrono::high_resolution_clock::now();
+        std::vector<TraceBuf2View> acceptedMessages;
+        Batch *batch{nullptr};
+        while (true)
+        {
+            // Time for heartbeating?
+            auto now = std::chrono::high_resolution_clock::now();
+            auto heartbeatDuration
+                = std::chrono::duration_cast<std::chrono::seconds>
+                  (now - heartbeatStartTime);
+            if (heartbeatDuration > mHeartbeatInterval)
+            {
+                try
+                {
+                    mOutputRing->writeHeartbeat(false);
+                }
+                catch (const std::exception &e)
+                {
+                    logger->error(e.what());
+                }
+                heartbeatStartTime = now;
+            }
+            if (!mWriterQueue->tryPop(&batch))
+            {
+                if (!mEngineRunning.load(std::memory_order_acquire) &&
+                    mWriterQueue->empty())
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(STAGE_WAIT);
+                continue;
+            }
+            const auto &views = batch->traceBuf2Views;
+            const auto &decisions = batch->decisions;
+            acceptedMessages.clear();
+            for (size_t i = 0; i < views.size(); ++i)
+            {
+                if (decisions[i] == Decision::Accept)
+                {
+                    acceptedMessages.push_back(views[i]);
+                }
+            }
+            if (!acceptedMessages.empty())
+            {
+                try
+                {
+                    auto summary = mOutputRing->writeBatch(acceptedMessages);
+                    if (summary.nFailed > 0)
+                    {
+                        logger->warn("Failed to write "
+                                   + std::to_string(summary.nFailed)
+                                   + " of "
+                                   + std::to_string(acceptedMessages.size())
+                                   + " packets to output ring");
+                    }
+                    mWritten.fetch_add(summary.nWritten,
+                                       std::memory_order_relaxed);
+                    mWriteFailures.fetch_add(summary.nFailed,
+                                             std::memory_order_relaxed);
+                    mWriteDuration.fetch_add(summary.duration.count(),
+                                             std::memory_order_relaxed);
+                }
+                catch (const std::exception &e)
+                {
+                    logger->error(e.what());
+                }
+            }
+            auto addedLatency
+                = std::chrono::duration_cast<std::chrono::microseconds>
+                  (std::chrono::steady_clock::now()
+                 - batch->previousScrapeEndTime).count();
+            ::updateMaximum(mMaximumAddedLatency, addedLatency);
+            mSumAddedLatency.fetch_add(addedLatency,
+                                       std::memory_order_relaxed);
+            mAddedLatencyCount.fetch_add(1, std::memory_order_relaxed);
+            // The free queue holds every batch so this cannot fail
+            auto &freeQueue = *mReaders[batch->source]->freeQueue;
+            while (!freeQueue.tryPush(std::move(batch)))
+            {
+                std::this_thread::sleep_for(STAGE_WAIT);
+            }
+        }
+        try
+        {
+            mOutputRing->writeHeartbeat(true);
+        }
+        catch (const std::exception &e)
+        {
+            logger->error(e.what());
+        }
+        mWriterRunning.store(false, std::memory_order_release);
+    }
+    void join()
+    {
+        for (auto &reader : mReaders)
+        {
+            if (reader->thread.joinable()){reader->thread.join();}
+        }
+        if (mEngineThread.joinable()){mEngineThread.join();}
+        if (mWriterThread.joinable()){mWriterThread.join();}
+    }
+    std::vector<std::unique_ptr<Reader>> mReaders;
+    std::vector<std::string> mRingNames;
+    std::unique_ptr<IWaveRing> mOutputRing;
+    ShardedEngine mEngine;
+    PollingStrategy mPollingStrategy;
+    std::vector<std::unique_ptr<Batch>> mBatches;
+    std::unique_ptr<SpscQueue<Batch *>> mWriterQueue;
+    std::vector<int> mReaderCPUs;
+    std::thread mEngineThread;
+    std::thread mWriterThread;
+    std::chrono::seconds mHeartbeatInterval{15};
+    std::chrono::seconds mLogBadDataInterval{3600};
+    std::chrono::seconds mSnapshotInterval{60};
+    std::filesystem::path mSnapshotFile;
+    /// The input ring's time when the pipeline started
+    std::chrono::microseconds mStartTime{0};
+    std::atomic<int> mMaximumEngineQueueDepth{0};
+    std::atomic<int> mMaximumWriterQueueDepth{0};
+    std::atomic<int> mReaderStalls{0};
+    std::atomic<int64_t> mMaximumAddedLatency{0};
+    std::atomic<int64_t> mSumAddedLatency{0};
+    std::atomic<int64_t> mAddedLatencyCount{0};
+    std::atomic<int64_t> mWritten{0};
+    std::atomic<int64_t> mWriteFailures{0};
+    std::atomic<int64_t> mWriteDuration{0};
+    std::atomic<bool> mKeepRunning{false};
+    std::atomic<bool> mEngineRunning{false};
+    std::atomic<bool> mWriterRunning{false};
+    int mNumberOfBatches{8};
+    int mEngineCPU{-1};
+    int mWriterCPU{-1};
+    bool mInitialized{false};
+};
+
+/// C'tor
+Pipeline::Pipeline() :
+    pImpl(std::make_unique<PipelineImpl> ())
+{
+}
+
+/// Destructor
+Pipeline::~Pipeline()
+{
+    stop();
+}
+
+/// Initialize
+void Pipeline::initialize(std::unique_ptr<IWaveRing> &&inputRing,
+                          std::unique_ptr<IWaveRing> &&outputRing,
+                          ShardedEngine &&engine)
+{
+    std::vector<std::unique_ptr<IWaveRing>> inputRings;
+    inputRings.push_back(std::move(inputRing));
+    initialize(std::move(inputRings), std::move(outputRing),
+               std::move(engine));
+}
+
+void Pipeline::initialize(std::vector<std::unique_ptr<IWaveRing>> &&inputRings,
+                          std::unique_ptr<IWaveRing> &&outputRing,
+                          ShardedEngine &&engine)
+{
+    if (isRunning()){throw std::runtime_error("Pipeline is running");}
+    if (inputRings.empty())
+    {
+        throw std::invalid_argument("No input rings");
+    }
+    for (const auto &inputRing : inputRings)
+    {
+        if (inputRing == nullptr || !inputRing->isConnected())
+        {
+            throw std::invalid_argument("Input ring not connected");
+        }
+    }
+    if (outputRing == nullptr || !outputRing->isConnected())
+    {
+        throw std::invalid_argument("Output ring not connected");
+    }
+    pImpl->mReaders.clear();
+    pImpl->mRingNames.clear();
+    for (auto &inputRing : inputRings)
+    {
+        pImpl->mRingNames.push_back(inputRing->getRingName());
+        pImpl->mReaders.push_back(std::make_unique<Reader> ());
+        pImpl->mReaders.back()->ring = std::move(inputRing);
+    }
+    inputRings.clear();
+    pImpl->mOutputRing = std::move(outputRing);
+    pImpl->mEngine = std::move(engine);
+    pImpl->mInitialized = true;
+}
+
+bool Pipeline::isInitialized() const noexcept
+{
+    return pImpl->mInitialized;
+}
+
+/// Number of batches
+void Pipeline::setNumberOfBatches(const int nBatches)
+{
+    if (nBatches < 1)
+    {
+        throw std::invalid_argument("Number of batches = "
+                                  + std::to_string(nBatches)
+                                  + " must be positive");
+    }
+    if (isRunning()){throw std::runtime_error("Pipeline is running");}
+    pImpl->mNumberOfBatches = nBatches;
+}
+
+int Pipeline::getNumberOfBatches() const noexcept
+{
+    return pImpl->mNumberOfBatches;
+}
+
+/// CPUs
+void Pipeline::setReaderCPUs(const std::vector<int> &cpus)
+{
+    pImpl->mReaderCPUs = cpus;
+}
+
+void Pipeline::setEngineCPU(const int cpu) noexcept
+{
+    pImpl->mEngineCPU = cpu;
+}
+
+void Pipeline::setWriterCPU(const int cpu) noexcept
+{
+    pImpl->mWriterCPU = cpu;
+}
+
+/// Intervals
+void Pipeline::setHeartbeatInterval(
+    const std::chrono::seconds &interval) noexcept
+{
+    pImpl->mHeartbeatInterval = interval;
+}
+
+void Pipeline::setLogBadDataInterval(
+    const std::chrono::seconds &interval) noexcept
+{
+    pImpl->mLogBadDataInterval = interval;
+}
+
+/// Snapshots
+void Pipeline::setSnapshot(const std::filesystem::path &fileName,
+                           const std::chrono::seconds &interval)
+{
+    if (isRunning()){throw std::runtime_error("Pipeline is running");}
+    pImpl->mSnapshotFile = fileName;
+    pImpl->mSnapshotInterval = interval;
+}
+
+/// Polling strategy
+void Pipeline::setPollingStrategy(const PollingStrategy &strategy)
+{
+    if (isRunning()){throw std::runtime_error("Pipeline is running");}
+    pImpl->mPollingStrategy = strategy;
+}
+
+/// Start
+void Pipeline::start()
+{
+    if (!isInitialized()){throw std::runtime_error("Pipeline not initialized");}
+    if (isRunning()){throw std::runtime_error("Pipeline already running");}
+    pImpl->join();
+    // Every batch starts on its reader's free queue.  Each queue can hold
+    // all the batches so a push never fails.
+    auto nBatches = pImpl->mNumberOfBatches;
+    auto nReaders = static_cast<int> (pImpl->mReaders.size());
+    pImpl->mBatches.clear();
+    pImpl->mWriterQueue
+        = std::make_unique<SpscQueue<Batch *>> (nReaders*nBatches);
+    for (int source = 0; source < nReaders; ++source)
+    {
+        auto &reader = *pImpl->mReaders[source];
+        reader.freeQueue = std::make_unique<SpscQueue<Batch *>> (nBatches);
+        reader.engineQueue = std::make_unique<SpscQueue<Batch *>> (nBatches);
+        reader.pollingStrategy = pImpl->mPollingStrategy;
+        reader.pollingStrategy.reset();
+        reader.cpu = -1;
+        if (source < static_cast<int> (pImpl->mReaderCPUs.size()))
+        {
+            reader.cpu = pImpl->mReaderCPUs[source];
+        }
+        for (int i = 0; i < nBatches; ++i)
+        {
+            pImpl->mBatches.push_back(std::make_unique<Batch> ());
+            auto batch = pImpl->mBatches.back().get();
+            batch->source = source;
+            if (!reader.freeQueue->tryPush(std::move(batch)))
+            {
+                throw std::runtime_error("Could not initialize free queue");
+            }
+        }
+    }
+    resetMaximumQueueDepths();
+    resetAddedLatency();
+    resetWriteSummary();
+    // Every run flag is set before any thread exists so the engine cannot
+    // mistake a reader that has not started for one that has finished
+    pImpl->mStartTime = pImpl->mReaders.at(0)->ring->getNow();
+    pImpl->mKeepRunning = true;
+    pImpl->mEngineRunning = true;
+    pImpl->mWriterRunning = true;
+    for (auto &reader : pImpl->mReaders)
+    {
+        reader->running = true;
+    }
+    pImpl->mWriterThread = std::thread(&PipelineImpl::write, &*pImpl);
+    pImpl->mEngineThread = std::thread(&PipelineImpl::process, &*pImpl);
+    ::pinThread(pImpl->mEngineThread, pImpl->mEngineCPU, "engine");
+    ::pinThread(pImpl->mWriterThread, pImpl->mWriterCPU, "writer");
+    for (int source = 0; source < nReaders; ++source)
+    {
+        auto reader = pImpl->mReaders[source].get();
+        reader->thread = std::thread(&PipelineImpl::read, &*pImpl, reader);
+        ::pinThread(reader->thread, reader->cpu,
+                    "reader for " + pImpl->mRingNames[source]);
+    }
+}
+
+/// Running?
+bool Pipeline::isRunning() const noexcept
+{
+    return pImpl->mWriterRunning.load(std::memory_order_acquire);
+}
+
+/// Stop
+void Pipeline::stop()
+{
+    pImpl->mKeepRunning = false;
+    pImpl->join();
+}
+
+/// Queue depths
+int Pipeline::getEngineQueueDepth() const noexcept
+{
+    int depth = 0;
+    for (const auto &reader : pImpl->mReaders)
+    {
+        if (reader->engineQueue){depth = depth + reader->engineQueue->size();}
+    }
+    return depth;
+}
+
+int Pipeline::getWriterQueueDepth() const noexcept
+{
+    return pImpl->mWriterQueue ? pImpl->mWriterQueue->size() : 0;
+}
+
+int Pipeline::getMaximumEngineQueueDepth() const noexcept
+{
+    return pImpl->mMaximumEngineQueueDepth.load(std::memory_order_relaxed);
+}
+
+int Pipeline::getMaximumWriterQueueDepth() const noexcept
+{
+    return pImpl->mMaximumWriterQueueDepth.load(std::memory_order_relaxed);
+}
+
+int Pipeline::getNumberOfReaderStalls() const noexcept
+{
+    return pImpl->mReaderStalls.load(std::memory_order_relaxed);
+}
+
+void Pipeline::resetMaximumQueueDepths() noexcept
+{
+    pImpl->mMaximumEngineQueueDepth = 0;
+    pImpl->mMaximumWriterQueueDepth = 0;
+    pImpl->mReaderStalls = 0;
+}
+
+/// Added latency
+std::chrono::microseconds Pipeline::getMaximumAddedLatency() const noexcept
+{
+    return std::chrono::microseconds
+           {pImpl->mMaximumAddedLatency.load(std::memory_order_relaxed)};
+}
+
+std::chrono::microseconds Pipeline::getMeanAddedLatency() const noexcept
+{
+    auto count = pImpl->mAddedLatencyCount.load(std::memory_order_relaxed);
+    if (count == 0){return std::chrono::microseconds {0};}
+    return std::chrono::microseconds
+           {pImpl->mSumAddedLatency.load(std::memory_order_relaxed)/count};
+}
+
+void Pipeline::resetAddedLatency() noexcept
+{
+    pImpl->mMaximumAddedLatency = 0;
+    pImpl->mSumAddedLatency = 0;
+    pImpl->mAddedLatencyCount = 0;
+}
+
+/// Write statistics
+WriteSummary Pipeline::getWriteSummary() const noexcept
+{
+    WriteSummary summary;
+    summary.nWritten
+        = static_cast<int> (pImpl->mWritten.load(std::memory_order_relaxed));
+    summary.nFailed
+        = static_cast<int>
+          (pImpl->mWriteFailures.load(std::memory_order_relaxed));
+    summary.duration
+        = std::chrono::microseconds
+          {pImpl->mWriteDuration.load(std::memory_order_relaxed)};
+    return summary;
+}
+
+void Pipeline::resetWriteSummary() noexcept
+{
+    pImpl->mWritten = 0;
+    pImpl->mWriteFailures = 0;
+    pImpl->mWriteDuration = 0;
+}
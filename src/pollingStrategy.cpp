@@ -0,0 +1,96 @@
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <deduplicator/pollingStrategy.hpp>
+
+using namespace Deduplicator;
+
+/// Mode
+void PollingStrategy::setMode(const Mode mode) noexcept
+{
+    mMode = mode;
+    reset();
+}
+
+PollingStrategy::Mode PollingStrategy::getMode() const noexcept
+{
+    return mMode;
+}
+
+/// Maximum added latency
+void PollingStrategy::setMaximumAddedLatency(
+    const std::chrono::microseconds &latency)
+{
+    if (latency.count() < 0)
+    {
+        throw std::invalid_argument("Maximum added latency is negative");
+    }
+    mMaximumAddedLatency = latency;
+    reset();
+}
+
+std::chrono::microseconds
+PollingStrategy::getMaximumAddedLatency() const noexcept
+{
+    return mMaximumAddedLatency;
+}
+
+/// Minimum wait
+void PollingStrategy::setMinimumWait(const std::chrono::microseconds &wait)
+{
+    if (wait.count() <= 0)
+    {
+        throw std::invalid_argument("Minimum wait must be positive");
+    }
+    mMinimumWait = wait;
+    reset();
+}
+
+std::chrono::microseconds PollingStrategy::getMinimumWait() const noexcept
+{
+    return mMinimumWait;
+}
+
+/// Reset
+void PollingStrategy::reset() noexcept
+{
+    mCurrentWait = std::chrono::microseconds {0};
+}
+
+/// Wait time
+std::chrono::microseconds PollingStrategy::computeWait(
+    const bool haveTraffic,
+    const std::chrono::microseconds &pollDuration) noexcept
+{
+    constexpr std::chrono::microseconds zero{0};
+    if (mMode == Mode::BusySpin){return zero;}
+    if (mMode == Mode::LatencyTarget)
+    {
+        return std::max(zero, mMaximumAddedLatency - pollDuration);
+    }
+    // Backoff.  Traffic usually comes in bursts so poll again right away.
+    if (haveTraffic)
+    {
+        reset();
+        return zero;
+    }
+    if (mCurrentWait == zero)
+    {
+        mCurrentWait = mMinimumWait;
+    }
+    else
+    {
+        mCurrentWait = 2*mCurrentWait;
+    }
+    mCurrentWait = std::min(mCurrentWait, mMaximumAddedLatency);
+    return mCurrentWait;
+}
+
+/// Wait
+void PollingStrategy::wait(const bool haveTraffic,
+                           const std::chrono::microseconds &pollDuration)
+{
+    auto waitTime = computeWait(haveTraffic, pollDuration);
+    if (waitTime.count() > 0){std::this_thread::sleep_for(waitTime);}
+}
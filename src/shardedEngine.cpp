@@ -0,0 +1,488 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+#include <deduplicator/shardedEngine.hpp>
+#include <deduplicator/engine.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/channelKey.hpp>
+#include "snapshot.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+
+/// The packets of a batch that belong to one shard.  Only the shard's
+/// thread touches the engine.
+struct Shard
+{
+    Engine engine;
+    std::vector<TraceBuf2View> packets;
+    std::vector<int> indices;
+    std::vector<Decision> decisions;
+    std::exception_ptr exception{nullptr};
+};
+
+/// Merges the sorted name lists of the shards
+template<typename F>
+std::vector<std::string> mergeNames(const std::vector<Shard> &shards,
+                                    F &&getNames)
+{
+    std::vector<std::string> result;
+    for (const auto &shard : shards)
+    {
+        auto names = getNames(shard.engine);
+        result.insert(result.end(),
+                      std::make_move_iterator(names.begin()),
+                      std::make_move_iterator(names.end()));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}
+
+class ShardedEngine::ShardedEngineImpl
+{
+public:
+    explicit ShardedEngineImpl(const int nShards) :
+        mShards(nShards)
+    {
+        mThreads.reserve(nShards - 1);
+        for (int i = 1; i < nShards; ++i)
+        {
+            mThreads.push_back(std::thread(&ShardedEngineImpl::work, this, i));
+        }
+    }
+    ~ShardedEngineImpl()
+    {
+        mKeepRunning.store(false, std::memory_order_release);
+        mGeneration.fetch_add(1, std::memory_order_release);
+        mGeneration.notify_all();
+        for (auto &thread : mThreads)
+        {
+            if (thread.joinable()){thread.join();}
+        }
+    }
+    /// Use the upper bits since the interner's hash table uses the lower
+    int getShard(const ChannelKey &key) const noexcept
+    {
+        return static_cast<int> ((key.getHash() >> 32) % mShards.size());
+    }
+    void processShard(const int index) noexcept
+    {
+        auto &shard = mShards[index];
+        try
+        {
+            shard.engine.process(shard.packets, mNow, mSource,
+                                 &shard.decisions);
+        }
+        catch (...)
+        {
+            shard.exception = std::current_exception();
+        }
+    }
+    /// Worker thread - waits for a new batch then processes its shard
+    void work(const int index)
+    {
+        // Start from the constructor's generation - the first batch may
+        // be posted before this thread runs
+        uint64_t generation{0};
+        while (true)
+        {
+            mGeneration.wait(generation, std::memory_order_acquire);
+            generation = mGeneration.load(std::memory_order_acquire);
+            if (!mKeepRunning.load(std::memory_order_acquire)){break;}
+            processShard(index);
+            if (mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                mPending.notify_one();
+            }
+        }
+    }
+    void process(const std::span<const TraceBuf2View> packets,
+                 const std::chrono::microseconds &now,
+                 const int source,
+                 std::vector<Decision> *decisions)
+    {
+        // Partition the batch
+        for (auto &shard : mShards)
+        {
+            shard.packets.clear();
+            shard.indices.clear();
+            shard.exception = nullptr;
+        }
+        for (int i = 0; i < static_cast<int> (packets.size()); ++i)
+        {
+            auto &shard = mShards[getShard(packets[i].getChannelKey())];
+            shard.packets.push_back(packets[i]);
+            shard.indices.push_back(i);
+        }
+        mNow = now;
+        mSource = source;
+        // Wake the workers and do the first shard here
+        mPending.store(static_cast<int> (mThreads.size()),
+                       std::memory_order_release);
+        mGeneration.fetch_add(1, std::memory_order_release);
+        mGeneration.notify_all();
+        processShard(0);
+        auto pending = mPending.load(std::memory_order_acquire);
+        while (pending != 0)
+        {
+            mPending.wait(pending, std::memory_order_acquire);
+            pending = mPending.load(std::memory_order_acquire);
+        }
+        // Scatter the decisions back to input order
+        decisions->resize(packets.size());
+        for (const auto &shard : mShards)
+        {
+            if (shard.exception){std::rethrow_exception(shard.exception);}
+            for (size_t i = 0; i < shard.indices.size(); ++i)
+            {
+                (*decisions)[shard.indices[i]] = shard.decisions[i];
+            }
+        }
+    }
+    std::vector<Shard> mShards;
+    std::vector<std::thread> mThreads;
+    std::atomic<uint64_t> mGeneration{0};
+    std::atomic<int> mPending{0};
+    std::atomic<bool> mKeepRunning{true};
+    std::chrono::microseconds mNow{0};
+    size_t mMemoryBudget{0};
+    int mSource{0};
+};
+
+/// C'tor
+ShardedEngine::ShardedEngine() :
+    pImpl(std::make_unique<ShardedEngineImpl> (1))
+{
+}
+
+ShardedEngine::ShardedEngine(const int nShards)
+{
+    if (nShards < 1)
+    {
+        throw std::invalid_argument("Number of shards = "
+                                  + std::to_string(nShards)
+                                  + " must be positive");
+    }
+    pImpl = std::make_unique<ShardedEngineImpl> (nShards);
+}
+
+/// Move c'tor
+ShardedEngine::ShardedEngine(ShardedEngine &&engine) noexcept
+{
+    *this = std::move(engine);
+}
+
+/// Move assignment
+ShardedEngine& ShardedEngine::operator=(ShardedEngine &&engine) noexcept
+{
+    if (&engine == this){return *this;}
+    pImpl = std::move(engine.pImpl);
+    return *this;
+}
+
+/// Destructor
+ShardedEngine::~ShardedEngine() = default;
+
+/// Reset class
+void ShardedEngine::clear() noexcept
+{
+    for (auto &shard : pImpl->mShards){shard.engine.clear();}
+}
+
+/// Shards
+int ShardedEngine::getNumberOfShards() const noexcept
+{
+    return static_cast<int> (pImpl->mShards.size());
+}
+
+int ShardedEngine::getShard(const ChannelKey &channelKey) const noexcept
+{
+    return pImpl->getShard(channelKey);
+}
+
+/// Maximum past time
+void ShardedEngine::setMaximumPastTime(
+    const std::chrono::seconds &maximumPastTime)
+{
+    for (auto &shard : pImpl->mShards)
+    {
+        shard.engine.setMaximumPastTime(maximumPastTime);
+    }
+}
+
+std::chrono::seconds ShardedEngine::getMaximumPastTime() const noexcept
+{
+    return pImpl->mShards[0].engine.getMaximumPastTime();
+}
+
+/// Maximum future time
+void ShardedEngine::setMaximumFutureTime(
+    const std::chrono::seconds &maximumFutureTime)
+{
+    for (auto &shard : pImpl->mShards)
+    {
+        shard.engine.setMaximumFutureTime(maximumFutureTime);
+    }
+}
+
+std::chrono::seconds ShardedEngine::getMaximumFutureTime() const noexcept
+{
+    return pImpl->mShards[0].engine.getMaximumFutureTime();
+}
+
+/// Circular buffer duration
+void ShardedEngine::setCircularBufferDuration(
+    const std::chrono::seconds &duration)
+{
+    for (auto &shard : pImpl->mShards)
+    {
+        shard.engine.setCircularBufferDuration(duration);
+    }
+}
+
+std::chrono::seconds
+ShardedEngine::getCircularBufferDuration() const noexcept
+{
+    return pImpl->mShards[0].engine.getCircularBufferDuration();
+}
+
+/// Process a batch
+void ShardedEngine::process(const std::span<const TraceBuf2View> packets,
+                            const std::chrono::microseconds &now,
+                            std::vector<Decision> *decisions)
+{
+    process(packets, now, 0, decisions);
+}
+
+/// Process a batch from a source
+void ShardedEngine::process(const std::span<const TraceBuf2View> packets,
+                            const std::chrono::microseconds &now,
+                            const int source,
+                            std::vector<Decision> *decisions)
+{
+    if (source < 0)
+    {
+        throw std::invalid_argument("Source = " + std::to_string(source)
+                                  + " must be non-negative");
+    }
+    if (decisions == nullptr)
+    {
+        throw std::invalid_argument("decisions is NULL");
+    }
+    // One shard - skip the partitioning
+    if (pImpl->mShards.size() == 1)
+    {
+        pImpl->mShards[0].engine.process(packets, now, source, decisions);
+        return;
+    }
+    pImpl->process(packets, now, source, decisions);
+}
+
+/// Seed.  This happens at startup so the shards are seeded in turn.
+int ShardedEngine::seed(const std::span<const TraceBuf2View> packets,
+                        const std::chrono::microseconds &now)
+{
+    if (pImpl->mShards.size() == 1)
+    {
+        return pImpl->mShards[0].engine.seed(packets, now);
+    }
+    std::vector<std::vector<TraceBuf2View>> shardPackets(pImpl->mShards.size());
+    for (const auto &packet : packets)
+    {
+        shardPackets[pImpl->getShard(packet.getChannelKey())].push_back(packet);
+    }
+    int nSeeded = 0;
+    for (size_t i = 0; i < pImpl->mShards.size(); ++i)
+    {
+        nSeeded = nSeeded
+                + pImpl->mShards[i].engine.seed(shardPackets[i], now);
+    }
+    return nSeeded;
+}
+
+/// Number of channels
+int ShardedEngine::getNumberOfChannels() const noexcept
+{
+    int nChannels{0};
+    for (const auto &shard : pImpl->mShards)
+    {
+        nChannels = nChannels + shard.engine.getNumberOfChannels();
+    }
+    return nChannels;
+}
+
+int ShardedEngine::getNumberOfActiveChannels() const noexcept
+{
+    int nChannels{0};
+    for (const auto &shard : pImpl->mShards)
+    {
+        nChannels = nChannels + shard.engine.getNumberOfActiveChannels();
+    }
+    return nChannels;
+}
+
+/// Memory
+size_t ShardedEngine::getMemoryUsage() const noexcept
+{
+    size_t memoryUsage{0};
+    for (const auto &shard : pImpl->mShards)
+    {
+        memoryUsage = memoryUsage + shard.engine.getMemoryUsage();
+    }
+    return memoryUsage;
+}
+
+/// Reaping
+void ShardedEngine::setMemoryBudget(const size_t budget) noexcept
+{
+    pImpl->mMemoryBudget = budget;
+    auto shardBudget = budget/pImpl->mShards.size();
+    // Don't let a tiny budget round to unlimited
+    if (budget > 0){shardBudget = std::max<size_t> (1, shardBudget);}
+    for (auto &shard : pImpl->mShards)
+    {
+        shard.engine.setMemoryBudget(shardBudget);
+    }
+}
+
+size_t ShardedEngine::getMemoryBudget() const noexcept
+{
+    return pImpl->mMemoryBudget;
+}
+
+void ShardedEngine::setReapInterval(
+    const std::chrono::seconds &interval) noexcept
+{
+    for (auto &shard : pImpl->mShards)
+    {
+        shard.engine.setReapInterval(interval);
+    }
+}
+
+std::chrono::seconds ShardedEngine::getReapInterval() const noexcept
+{
+    return pImpl->mShards[0].engine.getReapInterval();
+}
+
+std::pair<int, int> ShardedEngine::reap(const std::chrono::microseconds &now)
+{
+    std::pair<int, int> result{0, 0};
+    for (auto &shard : pImpl->mShards)
+    {
+        auto [nIdle, nEvicted] = shard.engine.reap(now);
+        result.first = result.first + nIdle;
+        result.second = result.second + nEvicted;
+    }
+    return result;
+}
+
+/// Bad channels
+std::vector<std::string> ShardedEngine::getExpiredChannels() const
+{
+    return ::mergeNames(pImpl->mShards,
+                        [](const Engine &engine)
+                        {
+                            return engine.getExpiredChannels();
+                        });
+}
+
+std::vector<std::string> ShardedEngine::getFutureChannels() const
+{
+    return ::mergeNames(pImpl->mShards,
+                        [](const Engine &engine)
+                        {
+                            return engine.getFutureChannels();
+                        });
+}
+
+std::vector<std::string> ShardedEngine::getDuplicateChannels() const
+{
+    return ::mergeNames(pImpl->mShards,
+                        [](const Engine &engine)
+                        {
+                            return engine.getDuplicateChannels();
+                        });
+}
+
+void ShardedEngine::clearBadChannels() noexcept
+{
+    for (auto &shard : pImpl->mShards){shard.engine.clearBadChannels();}
+}
+
+/// First deliveries
+std::vector<std::pair<std::string, std::vector<int>>>
+ShardedEngine::getFirstDeliveries() const
+{
+    std::vector<std::pair<std::string, std::vector<int>>> result;
+    size_t nSources{0};
+    for (const auto &shard : pImpl->mShards)
+    {
+        auto firstDeliveries = shard.engine.getFirstDeliveries();
+        for (auto &firstDelivery : firstDeliveries)
+        {
+            nSources = std::max(nSources, firstDelivery.second.size());
+            result.push_back(std::move(firstDelivery));
+        }
+    }
+    // Shards may have seen different numbers of sources
+    for (auto &firstDelivery : result)
+    {
+        firstDelivery.second.resize(nSources, 0);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const auto &lhs, const auto &rhs)
+              {
+                  return lhs.first < rhs.first;
+              });
+    return result;
+}
+
+void ShardedEngine::clearFirstDeliveries() noexcept
+{
+    for (auto &shard : pImpl->mShards){shard.engine.clearFirstDeliveries();}
+}
+
+/// Snapshots
+void ShardedEngine::saveSnapshot(const std::filesystem::path &fileName,
+                                 const std::chrono::microseconds &now) const
+{
+    std::vector<Snapshot::Channel> channels;
+    for (const auto &shard : pImpl->mShards)
+    {
+        auto shardChannels = shard.engine.exportChannels(now);
+        channels.insert(channels.end(),
+                        std::make_move_iterator(shardChannels.begin()),
+                        std::make_move_iterator(shardChannels.end()));
+    }
+    Snapshot::write(fileName, now.count(), channels);
+}
+
+int ShardedEngine::loadSnapshot(const std::filesystem::path &fileName,
+                                const std::chrono::microseconds &now)
+{
+    int64_t snapshotTime{0};
+    auto channels = Snapshot::read(fileName, &snapshotTime);
+    std::vector<std::vector<Snapshot::Channel>>
+        shardChannels(pImpl->mShards.size());
+    for (auto &channel : channels)
+    {
+        shardChannels[pImpl->getShard(channel.key)].push_back(
+            std::move(channel));
+    }
+    int nRestored = 0;
+    for (size_t i = 0; i < pImpl->mShards.size(); ++i)
+    {
+        nRestored = nRestored
+                  + pImpl->mShards[i].engine.importChannels(shardChannels[i],
+                                                            now);
+    }
+    return nRestored;
+}
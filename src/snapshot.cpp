@@ -0,0 +1,271 @@
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.hpp"
+#include "traceBuf2Layout.hpp"
+
+using namespace Deduplicator;
+
+namespace
+{
+constexpr std::array<char, 8> MAGIC{'D', 'E', 'D', 'U', 'P', 'S', 'N', 'P'};
+constexpr uint32_t VERSION{1};
+// Bytes  0 - 7:  magic
+// Bytes  8 - 11: version (uint32)
+// Bytes 12 - 15: number of channels (uint32)
+// Bytes 16 - 23: snapshot time (int64)
+// Bytes 24 - 31: file size (uint64)
+constexpr size_t SNAPSHOT_HEADER_SIZE{32};
+// Bytes  0 - 23: station, network, channel, location codes as in a
+//                tracebuf2 header
+// Bytes 24 - 31: sampling rate (double)
+// Bytes 32 - 39: last activity (int64)
+// Bytes 40 - 43: number of packets (int32)
+// Bytes 44 - 47: pad
+// Then the start times (int64) and sample counts (int32) padded to 8 bytes
+constexpr size_t RECORD_HEADER_SIZE{48};
+static_assert(TraceBuf2Layout::LOCATION_OFFSET
+            + TraceBuf2Layout::LOCATION_WIDTH
+            - TraceBuf2Layout::STATION_OFFSET <= 24,
+              "Codes do not fit");
+
+size_t padTo8(const size_t n) noexcept
+{
+    return (n + 7) & ~static_cast<size_t> (7);
+}
+
+size_t getRecordSize(const size_t nPackets) noexcept
+{
+    return RECORD_HEADER_SIZE
+         + nPackets*sizeof(int64_t) + padTo8(nPackets*sizeof(int32_t));
+}
+
+template<typename T>
+void pack(char *destination, const T value) noexcept
+{
+    std::memcpy(destination, &value, sizeof(T));
+}
+
+template<typename T>
+T unpack(const char *source) noexcept
+{
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+}
+
+void packField(char *destination, const std::string_view &field) noexcept
+{
+    std::copy(field.begin(), field.end(), destination);
+}
+
+std::string_view unpackField(const char *field, const int width) noexcept
+{
+    return std::string_view {field,
+                             TraceBuf2Layout::fieldLength(field, width)};
+}
+
+/// Closes the file and unmaps the memory on scope exit
+class MappedFile
+{
+public:
+    ~MappedFile()
+    {
+        if (mMemory != nullptr && mMemory != MAP_FAILED)
+        {
+            ::munmap(mMemory, mSize);
+        }
+        if (mDescriptor >= 0){::close(mDescriptor);}
+    }
+    void *mMemory{nullptr};
+    size_t mSize{0};
+    int mDescriptor{-1};
+};
+
+/// Writes the snapshot through a memory map
+void writeMapped(const std::filesystem::path &fileName,
+                 const size_t fileSize,
+                 const int64_t snapshotTime,
+                 const std::vector<Snapshot::Channel> &channels)
+{
+    using namespace TraceBuf2Layout;
+    MappedFile file;
+    file.mDescriptor = ::open(fileName.c_str(),
+                              O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file.mDescriptor < 0)
+    {
+        throw std::runtime_error("Could not open " + fileName.string());
+    }
+    if (::ftruncate(file.mDescriptor, static_cast<off_t> (fileSize)) != 0)
+    {
+        throw std::runtime_error("Could not size " + fileName.string());
+    }
+    file.mSize = fileSize;
+    file.mMemory = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, file.mDescriptor, 0);
+    if (file.mMemory == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + fileName.string());
+    }
+    // ftruncate zero filled the file so padding is already zero
+    auto buffer = static_cast<char *> (file.mMemory);
+    std::copy(MAGIC.begin(), MAGIC.end(), buffer);
+    ::pack<uint32_t>(buffer +  8, VERSION);
+    ::pack<uint32_t>(buffer + 12, static_cast<uint32_t> (channels.size()));
+    ::pack<int64_t> (buffer + 16, snapshotTime);
+    ::pack<uint64_t>(buffer + 24, static_cast<uint64_t> (fileSize));
+    auto record = buffer + SNAPSHOT_HEADER_SIZE;
+    constexpr int offset{STATION_OFFSET};
+    for (const auto &channel : channels)
+    {
+        auto nPackets = channel.startTimes.size();
+        ::packField(record + STATION_OFFSET  - offset,
+                    channel.key.getStation());
+        ::packField(record + NETWORK_OFFSET  - offset,
+                    channel.key.getNetwork());
+        ::packField(record + CHANNEL_OFFSET  - offset,
+                    channel.key.getChannel());
+        ::packField(record + LOCATION_OFFSET - offset,
+                    channel.key.getLocationCode());
+        ::pack<double> (record + 24, channel.samplingRate);
+        ::pack<int64_t>(record + 32, channel.lastActivity);
+        ::pack<int32_t>(record + 40, static_cast<int32_t> (nPackets));
+        auto startTimes = record + RECORD_HEADER_SIZE;
+        std::memcpy(startTimes, channel.startTimes.data(),
+                    nPackets*sizeof(int64_t));
+        std::memcpy(startTimes + nPackets*sizeof(int64_t),
+                    channel.nSamples.data(), nPackets*sizeof(int32_t));
+        record = record + getRecordSize(nPackets);
+    }
+    if (::msync(file.mMemory, fileSize, MS_SYNC) != 0)
+    {
+        throw std::runtime_error("Could not sync " + fileName.string());
+    }
+}
+
+}
+
+/// Write
+void Snapshot::write(const std::filesystem::path &fileName,
+                     const int64_t snapshotTime,
+                     const std::vector<Channel> &channels)
+{
+    size_t fileSize = SNAPSHOT_HEADER_SIZE;
+    for (const auto &channel : channels)
+    {
+        fileSize = fileSize + ::getRecordSize(channel.startTimes.size());
+    }
+    auto temporaryFileName = fileName;
+    temporaryFileName += ".tmp";
+    ::writeMapped(temporaryFileName, fileSize, snapshotTime, channels);
+    std::filesystem::rename(temporaryFileName, fileName);
+}
+
+/// Read
+std::vector<Snapshot::Channel>
+Snapshot::read(const std::filesystem::path &fileName, int64_t *snapshotTime)
+{
+    using namespace TraceBuf2Layout;
+    if (!std::filesystem::exists(fileName))
+    {
+        throw std::invalid_argument(fileName.string() + " does not exist");
+    }
+    MappedFile file;
+    file.mDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (file.mDescriptor < 0)
+    {
+        throw std::runtime_error("Could not open " + fileName.string());
+    }
+    struct stat status;
+    if (::fstat(file.mDescriptor, &status) != 0)
+    {
+        throw std::runtime_error("Could not stat " + fileName.string());
+    }
+    auto fileSize = static_cast<size_t> (status.st_size);
+    if (fileSize < SNAPSHOT_HEADER_SIZE)
+    {
+        throw std::runtime_error(fileName.string() + " is too small");
+    }
+    file.mSize = fileSize;
+    file.mMemory = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE,
+                          file.mDescriptor, 0);
+    if (file.mMemory == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map " + fileName.string());
+    }
+    auto buffer = static_cast<const char *> (file.mMemory);
+    if (!std::equal(MAGIC.begin(), MAGIC.end(), buffer))
+    {
+        throw std::runtime_error(fileName.string() + " is not a snapshot");
+    }
+    auto version = ::unpack<uint32_t> (buffer + 8);
+    if (version != VERSION)
+    {
+        throw std::runtime_error("Unsupported snapshot version "
+                               + std::to_string(version));
+    }
+    auto nChannels = ::unpack<uint32_t> (buffer + 12);
+    if (snapshotTime != nullptr)
+    {
+        *snapshotTime = ::unpack<int64_t> (buffer + 16);
+    }
+    if (::unpack<uint64_t> (buffer + 24) != fileSize)
+    {
+        throw std::runtime_error(fileName.string() + " is truncated");
+    }
+    // Every channel needs at least a record header so a corrupt count
+    // cannot make us reserve more than the file could hold
+    if (static_cast<size_t> (nChannels)
+      > (fileSize - SNAPSHOT_HEADER_SIZE)/RECORD_HEADER_SIZE)
+    {
+        throw std::runtime_error(fileName.string() + " is corrupt");
+    }
+    std::vector<Channel> channels;
+    channels.reserve(nChannels);
+    size_t position = SNAPSHOT_HEADER_SIZE;
+    for (uint32_t i = 0; i < nChannels; ++i)
+    {
+        if (position + RECORD_HEADER_SIZE > fileSize)
+        {
+            throw std::runtime_error(fileName.string() + " is corrupt");
+        }
+        auto record = buffer + position;
+        auto nPackets = ::unpack<int32_t> (record + 40);
+        if (nPackets < 0 ||
+            position + getRecordSize(nPackets) > fileSize)
+        {
+            throw std::runtime_error(fileName.string() + " is corrupt");
+        }
+        constexpr int offset{STATION_OFFSET};
+        Channel channel;
+        channel.key
+            = ChannelKey {::unpackField(record + NETWORK_OFFSET - offset,
+                                        NETWORK_WIDTH),
+                          ::unpackField(record + STATION_OFFSET - offset,
+                                        STATION_WIDTH),
+                          ::unpackField(record + CHANNEL_OFFSET - offset,
+                                        CHANNEL_WIDTH),
+                          ::unpackField(record + LOCATION_OFFSET - offset,
+                                        LOCATION_WIDTH)};
+        channel.samplingRate = ::unpack<double> (record + 24);
+        channel.lastActivity = ::unpack<int64_t> (record + 32);
+        channel.startTimes.resize(nPackets);
+        channel.nSamples.resize(nPackets);
+        auto startTimes = record + RECORD_HEADER_SIZE;
+        std::memcpy(channel.startTimes.data(), startTimes,
+                    nPackets*sizeof(int64_t));
+        std::memcpy(channel.nSamples.data(),
+                    startTimes + nPackets*sizeof(int64_t),
+                    nPackets*sizeof(int32_t));
+        channels.push_back(std::move(channel));
+        position = position + getRecordSize(nPackets);
+    }
+    return channels;
+}
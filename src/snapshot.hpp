@@ -0,0 +1,44 @@
+#ifndef DEDUPLICATOR_SNAPSHOT_HPP
+#define DEDUPLICATOR_SNAPSHOT_HPP
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+#include <deduplicator/channelKey.hpp>
+/// @brief Reads and writes checkpoints of the engine's channel histories.
+///        The file is a 32 byte header followed by a record for each
+///        channel.  Everything is in the host's byte order since the file
+///        is only meant to be read back by the same machine.
+namespace Deduplicator::Snapshot
+{
+/// @brief The retained packets of a channel.
+struct Channel
+{
+    ChannelKey key;
+    double samplingRate{0};
+    int64_t lastActivity{0};
+    std::vector<int64_t> startTimes;
+    std::vector<int32_t> nSamples;
+};
+
+/// @brief Writes the channels to a temporary file through a memory map
+///        then renames it to fileName so a crash never leaves a partial
+///        snapshot behind.
+/// @param[in] fileName      The snapshot file.
+/// @param[in] snapshotTime  The time of the snapshot in microseconds from
+///                          the epoch.
+/// @param[in] channels      The channels to write.
+/// @throws std::runtime_error if the file cannot be written.
+void write(const std::filesystem::path &fileName,
+           int64_t snapshotTime,
+           const std::vector<Channel> &channels);
+/// @brief Reads the channels from a memory mapped snapshot.
+/// @param[in] fileName       The snapshot file.
+/// @param[out] snapshotTime  The time of the snapshot in microseconds from
+///                           the epoch.
+/// @result The channels in the snapshot.
+/// @throws std::invalid_argument if the file does not exist.
+/// @throws std::runtime_error if the file is not a valid snapshot.
+[[nodiscard]] std::vector<Channel> read(const std::filesystem::path &fileName,
+                                        int64_t *snapshotTime);
+}
+#endif
@@ -0,0 +1,128 @@
+#ifndef DEDUPLICATOR_TIME_WINDOW_HPP
+#define DEDUPLICATOR_TIME_WINDOW_HPP
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
+#include <stdexcept>
+#include <deduplicator/channelKey.hpp>
+#include "traceBuf2Layout.hpp"
+namespace Deduplicator
+{
+/// @brief Rejects expired and future messages from their headers while a
+///        transport reads them.  This is shared by the transports so they
+///        make the same decisions.
+class TimeWindow
+{
+public:
+    /// @brief Sets the window.
+    /// @throws std::invalid_argument if either time is negative.
+    void set(const std::chrono::seconds &maximumPastTime,
+             const std::chrono::seconds &maximumFutureTime)
+    {
+        if (maximumPastTime < std::chrono::seconds {0})
+        {
+            throw std::invalid_argument("Max past time is negative");
+        }
+        if (maximumFutureTime < std::chrono::seconds {0})
+        {
+            throw std::invalid_argument("Max future time is negative");
+        }
+        mMaximumPastTime = maximumPastTime;
+        mMaximumFutureTime = maximumFutureTime;
+        mEnabled = true;
+    }
+    /// @result True indicates the window was set.
+    [[nodiscard]] bool isEnabled() const noexcept
+    {
+        return mEnabled;
+    }
+    /// @brief Centers the window on the given time.
+    void update(const std::chrono::microseconds &now) noexcept
+    {
+        mEarliestTime = now - mMaximumPastTime;
+        mLatestTime = now + mMaximumFutureTime;
+    }
+    /// @brief Decides from the header alone whether a message is expired or
+    ///        in the future.  Anything that looks malformed is kept so the
+    ///        view and engine can complain about it.
+    /// @param[in] getNow  Returns the current time.  This is only called
+    ///                    when a message appears to be in the future since
+    ///                    it may have arrived after the window was updated.
+    ///                    Like the engine, it is then judged against the
+    ///                    time it was read.
+    template<typename Clock>
+    [[nodiscard]] bool reject(const char *message, const size_t size,
+                              Clock &&getNow)
+    {
+        using namespace TraceBuf2Layout;
+        if (size < static_cast<size_t> (HEADER_SIZE) ||
+            !isSupportedDataType(message))
+        {
+            return false;
+        }
+        auto times = unpackTimes(message);
+        if (!times.valid){return false;}
+        // The window only moves forward so this stays expired
+        if (times.startTime < mEarliestTime.count())
+        {
+            mExpiredChannels.insert(ChannelKey::fromHeader(message));
+            return true;
+        }
+        if (times.endTime > mLatestTime.count())
+        {
+            update(getNow());
+            if (times.endTime > mLatestTime.count())
+            {
+                mFutureChannels.insert(ChannelKey::fromHeader(message));
+                return true;
+            }
+        }
+        return false;
+    }
+    /// @result The sorted names of the channels with expired messages.
+    [[nodiscard]] std::vector<std::string> getExpiredChannels() const
+    {
+        return toNames(mExpiredChannels);
+    }
+    /// @result The sorted names of the channels with future messages.
+    [[nodiscard]] std::vector<std::string> getFutureChannels() const
+    {
+        return toNames(mFutureChannels);
+    }
+    /// @brief Resets the expired and future channels.
+    void clearRejectedChannels() noexcept
+    {
+        mExpiredChannels.clear();
+        mFutureChannels.clear();
+    }
+private:
+    struct ChannelKeyHash
+    {
+        size_t operator()(const ChannelKey &key) const noexcept
+        {
+            return static_cast<size_t> (key.getHash());
+        }
+    };
+    using ChannelSet = std::unordered_set<ChannelKey, ChannelKeyHash>;
+    static std::vector<std::string> toNames(const ChannelSet &keys)
+    {
+        std::vector<std::string> names;
+        names.reserve(keys.size());
+        for (const auto &key : keys){names.push_back(key.toName());}
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+    /// Channels whose messages were rejected
+    ChannelSet mExpiredChannels;
+    ChannelSet mFutureChannels;
+    std::chrono::seconds mMaximumPastTime{0};
+    std::chrono::seconds mMaximumFutureTime{0};
+    /// The acceptable times for the current read
+    std::chrono::microseconds mEarliestTime{0};
+    std::chrono::microseconds mLatestTime{0};
+    bool mEnabled{false};
+};
+}
+#endif
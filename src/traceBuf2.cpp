@@ -10,6 +10,7 @@
 #include <bit>
 #include <spdlog/spdlog.h>
 #include <deduplicator/traceBuf2.hpp>
+#include "traceBuf2Layout.hpp"
 #ifdef WITH_EARTHWORM
    #include "trace_buf.h"
    #define MAX_TRACE_SIZE (MAX_TRACEBUF_SIZ - 64)
@@ -28,6 +29,7 @@
 #endif
 
 using namespace Deduplicator;
+using namespace Deduplicator::TraceBuf2Layout;
  
 namespace
 {
@@ -120,48 +122,8 @@ int getMaxTraceLength() noexcept
     return MAX_TRACE_SIZE/sizeof(T);
 }
 
-/// Unpacks data
-template<typename T> T unpack(const char *__restrict__ cIn,
-                              const bool swap = false)
-{
-    union
-    {
-        char c[sizeof(T)];
-        T value;
-    };
-    if (!swap)
-    {
-        std::copy(cIn, cIn + sizeof(T), c);
-    }
-    else
-    {
-        std::reverse_copy(cIn, cIn + sizeof(T), c);
-    }
-    return value;
-}
-
-/// Packs data
-template<typename T>
-void pack(const T inputValue, char *packedData, const bool swap = false)
-{
-    union
-    {
-         char c[sizeof(T)];
-         T value;
-    };
-    value = inputValue; 
-    if (!swap)
-    {
-        std::copy(c, c + sizeof(T), packedData);
-    }
-    else
-    {
-        std::reverse_copy(c, c + sizeof(T), packedData);
-    }
-}
-
 template<typename T, typename U> std::vector<T> 
-unpack(const char *__restrict__ cIn, const int nSamples, const bool swap)
+unpackSamples(const char *__restrict__ cIn, const int nSamples, const bool swap)
 {
     std::vector<T> result(nSamples);
     if (!swap)
@@ -271,12 +233,15 @@ TraceBuf2 unpackEarthwormMessage(const char *message, const size_t messageLength
     if (!swap)
     {
         constexpr bool swapPass = false;
-        auto pinno        = ::unpack<int>(&message[0],      swapPass);
-        auto nsamp        = ::unpack<int>(&message[4],      swapPass);
-        auto startTime    = ::unpack<double>(&message[8],   swapPass);
-        //auto endTime    = ::unpack<double>(&message[16],  swapPass);
-        auto samplingRate = ::unpack<double>(&message[24],  swapPass);
-        auto quality      = ::unpack<int16_t>(&message[60], swapPass);
+        auto pinno        = unpack<int>(&message[PIN_NUMBER_OFFSET], swapPass);
+        auto nsamp        = unpack<int>(&message[NUMBER_OF_SAMPLES_OFFSET],
+                                        swapPass);
+        auto startTime    = unpack<double>(&message[START_TIME_OFFSET],
+                                           swapPass);
+        auto samplingRate = unpack<double>(&message[SAMPLING_RATE_OFFSET],
+                                           swapPass);
+        auto quality      = unpack<int16_t>(&message[QUALITY_OFFSET],
+                                            swapPass);
         result.setPinNumber(pinno);
         result.setStartTime(startTime);
         result.setSamplingRate(samplingRate);
@@ -327,11 +292,15 @@ TraceBuf2 unpackEarthwormMessage(const char *message, const size_t messageLength
     else
     {
         constexpr bool swapPass = true;
-        auto pinno        = unpack<int>(&message[0],      swapPass);
-        auto nsamp        = unpack<int>(&message[4],      swapPass);
-        auto startTime    = unpack<double>(&message[8],   swapPass);
-        auto samplingRate = unpack<double>(&message[24],  swapPass);
-        auto quality      = unpack<int16_t>(&message[60], swapPass);
+        auto pinno        = unpack<int>(&message[PIN_NUMBER_OFFSET], swapPass);
+        auto nsamp        = unpack<int>(&message[NUMBER_OF_SAMPLES_OFFSET],
+                                        swapPass);
+        auto startTime    = unpack<double>(&message[START_TIME_OFFSET],
+                                           swapPass);
+        auto samplingRate = unpack<double>(&message[SAMPLING_RATE_OFFSET],
+                                           swapPass);
+        auto quality      = unpack<int16_t>(&message[QUALITY_OFFSET],
+                                            swapPass);
         result.setPinNumber(pinno);
         result.setStartTime(startTime);
         result.setSamplingRate(samplingRate);
@@ -384,15 +353,6 @@ TraceBuf2 unpackEarthwormMessage(const char *message, const size_t messageLength
 class TraceBuf2::TraceBuf2Impl
 {
 public:
-    void updateEndTime()
-    {
-        mEndTime = mStartTime;
-        if (mSamples > 0 && mSamplingRate > 0)
-        {
-            mEndTime = mStartTime
-                     + static_cast<double> (mSamples - 1)/mSamplingRate;
-        }
-    }
     void clear() noexcept
     {
         //mData.clear();
@@ -404,7 +364,6 @@ public:
         mMessageLength = 0;
         mQuality = 0;//"\0\0";
         mStartTime = 0;
-        mEndTime = 0;
         mSamplingRate = 0;
         mPinNumber = 0;
     }
@@ -430,8 +389,6 @@ public:
     //std::string mQuality{2, '\0'}; // Default to no quality
     /// The UTC time of the first sample in seconds from the epoch.
     double mStartTime{0};
-    /// The UTC time of the last sample in seconds from the epoch.
-    double mEndTime{0};
     /// The sampling rate in Hz.
     double mSamplingRate{0};
     /// The pin number.
@@ -550,7 +507,6 @@ int TraceBuf2::getMaximumLocationCodeLength() noexcept
 void TraceBuf2::setStartTime(const double startTime) noexcept
 {
     pImpl->mStartTime = startTime;
-    pImpl->updateEndTime();
 }
 
 double TraceBuf2::getStartTime() const noexcept
@@ -569,7 +525,9 @@ double TraceBuf2::getEndTime() const
     {
         throw std::runtime_error("No samples in signal");
     }
-    return pImpl->mEndTime;
+    // This is rarely needed so compute it here rather than in every setter
+    return pImpl->mStartTime
+         + static_cast<double> (pImpl->mSamples - 1)/pImpl->mSamplingRate;
 }
 
 /// Set the sampling rate
@@ -582,7 +540,6 @@ void TraceBuf2::setSamplingRate(const double samplingRate)
                                   + " must be positive");
     }
     pImpl->mSamplingRate = samplingRate;
-    pImpl->updateEndTime();
 }
 
 double TraceBuf2::getSamplingRate() const
@@ -644,9 +601,12 @@ void TraceBuf2::setNativePacket(const char *message,
                                 const size_t messageLength)
 {
     if (message == nullptr){throw std::runtime_error("message is NULL");}
-    std::fill(pImpl->mRawData.begin() + messageLength,
-              pImpl->mRawData.end(), 
-              '\0');
+    if (messageLength > pImpl->mRawData.size())
+    {
+        throw std::invalid_argument("Message length = "
+                                  + std::to_string(messageLength)
+                                  + " is too big");
+    }
     std::copy(message, message + messageLength, pImpl->mRawData.begin());
     pImpl->mMessageLength = messageLength;
 }
@@ -679,7 +639,6 @@ template<class T>
 void TraceBuf2<T>::setData(std::vector<T> &&x) noexcept
 {
     pImpl->mData = std::move(x); 
-    pImpl->updateEndTime();
 }
 
 /// Set data
@@ -694,7 +653,6 @@ void TraceBuf2<T>::setData(const int nSamples, const U *__restrict__ x)
     }
     // No data so nothing to do
     pImpl->mData.resize(nSamples);
-    pImpl->updateEndTime();
     if (nSamples == 0){return;}
     if (x == nullptr){throw std::invalid_argument("x is NULL");}
     T *__restrict__ dPtr = pImpl->mData.data(); 
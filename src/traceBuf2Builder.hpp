@@ -0,0 +1,123 @@
+#ifndef DEDUPLICATOR_TRACEBUF2_BUILDER_HPP
+#define DEDUPLICATOR_TRACEBUF2_BUILDER_HPP
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <deduplicator/channelKey.hpp>
+#include "traceBuf2Layout.hpp"
+/// @brief Packs tracebuf2 messages exactly as a data logger would.  The
+///        header is packed through the same layout the library decodes
+///        with.  This is shared by the generator and the benchmarks.
+namespace Deduplicator::TraceBuf2Builder
+{
+
+/// @brief Copies a code into its NULL padded header field.
+inline void packCode(const std::string_view code, const int width,
+                     char *field)
+{
+    std::fill(field, field + width, '\0');
+    std::copy(code.begin(),
+              code.begin()
+            + std::min(code.size(), static_cast<size_t> (width - 1)),
+              field);
+}
+
+/// @brief Packs a slow sinusoid so consecutive packets look like a waveform.
+/// @param[in] firstSample  The index of the first sample in the channel's
+///                         sample stream.
+template<typename T>
+void packSamples(const int nSamples, const int64_t firstSample,
+                 const bool swap, char *samples)
+{
+    for (int i = 0; i < nSamples; ++i)
+    {
+        auto value = 1000*std::sin(0.01*static_cast<double> (firstSample + i));
+        TraceBuf2Layout::pack<T> (static_cast<T> (value),
+                                  samples + i*sizeof(T), swap);
+    }
+}
+
+/// @result A tracebuf2 message.
+/// @param[in] key           The network, station, channel, and location code.
+/// @param[in] startTime     The time of the first sample in seconds from
+///                          the epoch.
+/// @param[in] dataType      The data type, e.g., i4 or t8.  s and t are
+///                          big endian.
+/// @param[in] nSamples      The number of samples.
+/// @param[in] samplingRate  The sampling rate in Hz.
+/// @param[in] pinNumber     The pin number.
+/// @param[in] firstSample   The index of the first sample in the channel's
+///                          sample stream.
+inline std::vector<char> createMessage(const ChannelKey &key,
+                                       const double startTime,
+                                       const std::string &dataType,
+                                       const int nSamples,
+                                       const double samplingRate,
+                                       const int pinNumber = 0,
+                                       const int64_t firstSample = 0)
+{
+    using namespace TraceBuf2Layout;
+    auto type = dataType.at(0);
+    auto sampleSize = static_cast<int> (dataType.at(1) - '0');
+    std::vector<char> message(HEADER_SIZE + sampleSize*nSamples, '\0');
+    auto header = message.data();
+    // The header is in the same byte order as the samples
+    header[DATA_TYPE_OFFSET] = type;
+    header[DATA_TYPE_OFFSET + 1] = dataType[1];
+    auto swap = needsSwap(header);
+    pack<int> (pinNumber, header + PIN_NUMBER_OFFSET, swap);
+    pack<int> (nSamples, header + NUMBER_OF_SAMPLES_OFFSET, swap);
+    pack<double> (startTime, header + START_TIME_OFFSET, swap);
+    pack<double> (startTime + (nSamples - 1)/samplingRate,
+                  header + END_TIME_OFFSET, swap);
+    pack<double> (samplingRate, header + SAMPLING_RATE_OFFSET, swap);
+    packCode(key.getStation(), STATION_WIDTH, header + STATION_OFFSET);
+    packCode(key.getNetwork(), NETWORK_WIDTH, header + NETWORK_OFFSET);
+    packCode(key.getChannel(), CHANNEL_WIDTH, header + CHANNEL_OFFSET);
+    packCode(key.getLocationCode(), LOCATION_WIDTH,
+             header + LOCATION_OFFSET);
+    header[VERSION_OFFSET] = '2';
+    header[VERSION_OFFSET + 1] = '0';
+    auto samples = header + HEADER_SIZE;
+    if (type == 'i' || type == 's')
+    {
+        if (sampleSize == 2)
+        {
+            packSamples<int16_t> (nSamples, firstSample, swap, samples);
+        }
+        else
+        {
+            packSamples<int32_t> (nSamples, firstSample, swap, samples);
+        }
+    }
+    else
+    {
+        if (sampleSize == 4)
+        {
+            packSamples<float> (nSamples, firstSample, swap, samples);
+        }
+        else
+        {
+            packSamples<double> (nSamples, firstSample, swap, samples);
+        }
+    }
+    return message;
+}
+
+/// @brief Moves the message later in time.
+inline void shiftMessage(const double seconds, std::vector<char> *message)
+{
+    using namespace TraceBuf2Layout;
+    auto header = message->data();
+    auto swap = needsSwap(header);
+    auto startTime = unpack<double> (header + START_TIME_OFFSET, swap);
+    auto endTime = unpack<double> (header + END_TIME_OFFSET, swap);
+    pack<double> (startTime + seconds, header + START_TIME_OFFSET, swap);
+    pack<double> (endTime + seconds, header + END_TIME_OFFSET, swap);
+}
+
+}
+#endif
@@ -0,0 +1,178 @@
+#ifndef DEDUPLICATOR_TRACEBUF2_LAYOUT_HPP
+#define DEDUPLICATOR_TRACEBUF2_LAYOUT_HPP
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+/// @brief Describes the byte layout of an Earthworm TRACE2_HEADER.  This is
+///        shared by the owning and non-owning tracebuf2 representations so
+///        that they decode headers identically.
+namespace Deduplicator::TraceBuf2Layout
+{
+// Bytes  0 - 3:  pinno (int)
+// Bytes  4 - 7:  nsamp (int)
+// Bytes  8 - 15: starttime (double)
+// Bytes 16 - 23: endtime (double)
+// Bytes 24 - 31: sampling rate (double)
+// Bytes 32 - 38: station (char)
+// Bytes 39 - 47: network (char)
+// Bytes 48 - 51: channel (char)
+// Bytes 52 - 54: location (char)
+// Bytes 55 - 56: version (char)
+// Bytes 57 - 59: datatype (char)
+// Bytes 60 - 61: quality (char)
+// Bytes 62 - 63: pad (char)
+constexpr int PIN_NUMBER_OFFSET{0};
+constexpr int NUMBER_OF_SAMPLES_OFFSET{4};
+constexpr int START_TIME_OFFSET{8};
+constexpr int END_TIME_OFFSET{16};
+constexpr int SAMPLING_RATE_OFFSET{24};
+constexpr int STATION_OFFSET{32};
+constexpr int NETWORK_OFFSET{39};
+constexpr int CHANNEL_OFFSET{48};
+constexpr int LOCATION_OFFSET{52};
+constexpr int VERSION_OFFSET{55};
+constexpr int DATA_TYPE_OFFSET{57};
+constexpr int QUALITY_OFFSET{60};
+constexpr int HEADER_SIZE{64};
+/// These are Earthworm's TRACE2_*_LEN and include the NULL terminator.
+constexpr int STATION_WIDTH{7};
+constexpr int NETWORK_WIDTH{9};
+constexpr int CHANNEL_WIDTH{4};
+constexpr int LOCATION_WIDTH{3};
+constexpr int VERSION_WIDTH{2};
+/// Earthworm's MAX_TRACEBUF_SIZ.
+constexpr int MAXIMUM_MESSAGE_SIZE{4096};
+
+/// Unpacks a value from the message.
+template<typename T>
+[[nodiscard]] inline T unpack(const char *__restrict__ cIn,
+                              const bool swap = false) noexcept
+{
+    std::array<char, sizeof(T)> c;
+    if (!swap)
+    {
+        std::copy(cIn, cIn + sizeof(T), c.begin());
+    }
+    else
+    {
+        std::reverse_copy(cIn, cIn + sizeof(T), c.begin());
+    }
+    return std::bit_cast<T> (c);
+}
+
+/// Packs a value into the message.
+template<typename T>
+inline void pack(const T inputValue, char *packedData,
+                 const bool swap = false) noexcept
+{
+    auto c = std::bit_cast<std::array<char, sizeof(T)>> (inputValue);
+    if (!swap)
+    {
+        std::copy(c.begin(), c.end(), packedData);
+    }
+    else
+    {
+        std::reverse_copy(c.begin(), c.end(), packedData);
+    }
+}
+
+/// @result True indicates the datatype in the message header is one that
+///         we know how to handle.
+[[nodiscard]] inline bool isSupportedDataType(const char *message) noexcept
+{
+    auto type = message[DATA_TYPE_OFFSET];
+    auto size = message[DATA_TYPE_OFFSET + 1];
+    if (type == 'i' || type == 's')
+    {
+        return (size == '2' || size == '4' || size == '8');
+    }
+    if (type == 'f' || type == 't')
+    {
+        return (size == '4' || size == '8');
+    }
+    return false;
+}
+
+/// @result True indicates the header's numbers must be byte swapped on this
+///         machine.  Here, i and f are little endian while s and t are
+///         big endian.
+[[nodiscard]] inline bool needsSwap(const char *message) noexcept
+{
+    auto type = message[DATA_TYPE_OFFSET];
+    if (type == 's' || type == 't')
+    {
+        return std::endian::native == std::endian::little;
+    }
+    return std::endian::native == std::endian::big;
+}
+
+/// @result The length of the NULL terminated string in a fixed-width field.
+///         At most width - 1 characters are considered.
+[[nodiscard]] inline size_t fieldLength(const char *field,
+                                        const int width) noexcept
+{
+    return strnlen(field, static_cast<size_t> (width - 1));
+}
+
+
+/// The header's times as they are used for deduplication.  The times are
+/// converted to integer microseconds once, here, so every comparison after
+/// this is exact.
+struct Times
+{
+    /// The time of the first sample in microseconds from the epoch.
+    int64_t startTime{0};
+    /// The time of the last sample in microseconds from the epoch.
+    int64_t endTime{0};
+    /// The sampling rate in Hz.
+    double samplingRate{0};
+    /// The number of samples.
+    int nSamples{0};
+    /// False indicates there are no samples, the sampling rate is not
+    /// positive, or the times cannot be represented.
+    bool valid{false};
+};
+
+/// Start times and durations are limited to this many seconds so their sum
+/// cannot overflow int64 microseconds.
+constexpr double MAXIMUM_TIME{4.e12};
+
+/// @result The time in seconds rounded to the nearest microsecond.
+/// @note The magnitude of time must be less than MAXIMUM_TIME.
+[[nodiscard]] inline int64_t toMicroSeconds(const double time) noexcept
+{
+    // Rounds half away from zero like std::llround but the truncation
+    // compiles to a single instruction rather than a library call
+    auto scaled = time*1.e6;
+    if (scaled < 0){return -static_cast<int64_t> (0.5 - scaled);}
+    return static_cast<int64_t> (scaled + 0.5);
+}
+
+/// @result The start time, end time, number of samples, and sampling rate
+///         unpacked from the message's header.  The message's data type
+///         must be supported.
+[[nodiscard]] inline Times unpackTimes(const char *message) noexcept
+{
+    auto swap = needsSwap(message);
+    Times times;
+    auto startTime = unpack<double> (message + START_TIME_OFFSET, swap);
+    times.nSamples = unpack<int> (message + NUMBER_OF_SAMPLES_OFFSET, swap);
+    times.samplingRate = unpack<double> (message + SAMPLING_RATE_OFFSET, swap);
+    if (!(std::abs(startTime) < MAXIMUM_TIME)){return times;}
+    times.startTime = toMicroSeconds(startTime);
+    times.endTime = times.startTime;
+    if (times.nSamples < 1 || !(times.samplingRate > 0)){return times;}
+    // Round the duration on its own so the end minus the start time does
+    // not depend on the start time
+    auto duration = (times.nSamples - 1)/times.samplingRate;
+    if (!(duration < MAXIMUM_TIME)){return times;}
+    times.endTime = times.startTime + toMicroSeconds(duration);
+    times.valid = true;
+    return times;
+}
+
+}
+#endif
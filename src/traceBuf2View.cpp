@@ -0,0 +1,161 @@
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/traceBuf2.hpp>
+#include <deduplicator/channelKey.hpp>
+#include "traceBuf2Layout.hpp"
+
+using namespace Deduplicator;
+using namespace Deduplicator::TraceBuf2Layout;
+
+static_assert(std::is_trivially_copyable_v<TraceBuf2View>,
+              "TraceBuf2View must be trivially copyable");
+
+/// C'tor
+TraceBuf2View::TraceBuf2View(const char *message, const size_t messageLength)
+{
+    if (message == nullptr){throw std::invalid_argument("message is NULL");}
+    if (messageLength < static_cast<size_t> (HEADER_SIZE))
+    {
+        throw std::invalid_argument("Message length = "
+                                  + std::to_string(messageLength)
+                                  + " is smaller than the header");
+    }
+    if (messageLength > static_cast<size_t> (MAXIMUM_MESSAGE_SIZE))
+    {
+        throw std::invalid_argument("Message length = "
+                                  + std::to_string(messageLength)
+                                  + " is too big");
+    }
+    if (!isSupportedDataType(message))
+    {
+        throw std::invalid_argument("Unhandled data type");
+    }
+    mMessage = message;
+    mMessageLength = messageLength;
+    mSwap = needsSwap(message);
+}
+
+/// Pin number
+int TraceBuf2View::getPinNumber() const noexcept
+{
+    return unpack<int>(mMessage + PIN_NUMBER_OFFSET, mSwap);
+}
+
+/// Number of samples
+int TraceBuf2View::getNumberOfSamples() const noexcept
+{
+    return unpack<int>(mMessage + NUMBER_OF_SAMPLES_OFFSET, mSwap);
+}
+
+/// Start time
+double TraceBuf2View::getStartTime() const noexcept
+{
+    return unpack<double>(mMessage + START_TIME_OFFSET, mSwap);
+}
+
+/// End time
+double TraceBuf2View::getEndTime() const
+{
+    auto samplingRate = getSamplingRate();
+    auto nSamples = getNumberOfSamples();
+    if (nSamples < 1){throw std::runtime_error("No samples in signal");}
+    return getStartTime() + static_cast<double> (nSamples - 1)/samplingRate;
+}
+
+/// Sampling rate
+double TraceBuf2View::getSamplingRate() const
+{
+    auto samplingRate = unpack<double>(mMessage + SAMPLING_RATE_OFFSET, mSwap);
+    if (!(samplingRate > 0))
+    {
+        throw std::runtime_error("Sampling rate not set");
+    }
+    return samplingRate;
+}
+
+bool TraceBuf2View::haveSamplingRate() const noexcept
+{
+    return unpack<double>(mMessage + SAMPLING_RATE_OFFSET, mSwap) > 0;
+}
+
+/// Network
+std::string_view TraceBuf2View::getNetwork() const noexcept
+{
+    auto field = mMessage + NETWORK_OFFSET;
+    return std::string_view {field, fieldLength(field, NETWORK_WIDTH)};
+}
+
+/// Station
+std::string_view TraceBuf2View::getStation() const noexcept
+{
+    auto field = mMessage + STATION_OFFSET;
+    return std::string_view {field, fieldLength(field, STATION_WIDTH)};
+}
+
+/// Channel
+std::string_view TraceBuf2View::getChannel() const noexcept
+{
+    auto field = mMessage + CHANNEL_OFFSET;
+    return std::string_view {field, fieldLength(field, CHANNEL_WIDTH)};
+}
+
+/// Location code
+std::string_view TraceBuf2View::getLocationCode() const noexcept
+{
+    auto field = mMessage + LOCATION_OFFSET;
+    return std::string_view {field, fieldLength(field, LOCATION_WIDTH)};
+}
+
+/// Channel key
+ChannelKey TraceBuf2View::getChannelKey() const noexcept
+{
+    if (!haveMessage()){return ChannelKey {};}
+    return ChannelKey::fromHeader(mMessage);
+}
+
+/// Version
+std::string_view TraceBuf2View::getVersion() const noexcept
+{
+    return std::string_view {mMessage + VERSION_OFFSET, VERSION_WIDTH};
+}
+
+/// Data type
+std::string_view TraceBuf2View::getDataType() const noexcept
+{
+    return std::string_view {mMessage + DATA_TYPE_OFFSET, 2};
+}
+
+/// Quality
+int TraceBuf2View::getQuality() const noexcept
+{
+    return unpack<int16_t>(mMessage + QUALITY_OFFSET, mSwap);
+}
+
+/// Have message?
+bool TraceBuf2View::haveMessage() const noexcept
+{
+    return mMessage != nullptr;
+}
+
+/// Native packet
+const char *TraceBuf2View::getNativePacketPointer() const noexcept
+{
+    return mMessage;
+}
+
+size_t TraceBuf2View::getMessageLength() const noexcept
+{
+    return mMessageLength;
+}
+
+/// Make a copy
+TraceBuf2 TraceBuf2View::toTraceBuf2() const
+{
+    if (!haveMessage()){throw std::runtime_error("No message");}
+    TraceBuf2 result;
+    result.fromEarthworm(mMessage, mMessageLength);
+    return result;
+}
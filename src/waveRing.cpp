@@ -8,6 +8,8 @@
 #include <cstring>
 #include <vector>
 #include <map>
+#include <stdexcept>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 #undef WITH_MSEED
 #ifdef WITH_MSEED
@@ -23,6 +25,11 @@ extern "C"
 #endif
 #include <deduplicator/waveRing.hpp>
 #include <deduplicator/traceBuf2.hpp>
+#include <deduplicator/traceBuf2View.hpp>
+#include <deduplicator/messageSlab.hpp>
+#include <deduplicator/channelKey.hpp>
+#include <deduplicator/captureRecorder.hpp>
+#include "timeWindow.hpp"
 
 using namespace Deduplicator;
 
@@ -40,13 +47,44 @@ std::array<char, 15> INST_WILDCARD{"INST_WILDCARD\0"};
 std::array<char, 16> TYPE_HEARTBEAT{"TYPE_HEARTBEAT\0"};
 std::array<char, 16> TYPE_TRACEBUF2{"TYPE_TRACEBUF2\0"};
 //std::array<char, 21> TYPE_TRACECOMP2{"TYPE_TRACE2_COMP_UA\0"};
+
+std::chrono::microseconds getNow() noexcept
+{
+    return std::chrono::time_point_cast<std::chrono::microseconds>
+           (std::chrono::high_resolution_clock::now()).time_since_epoch();
+}
 }
 
 class WaveRing::WaveRingImpl
 {
 public:
-    /// Earthworm messages
+    /// Unpacks the views into owning tracebuf2 messages on demand.
+    void materializeTraceBuf2Messages()
+    {
+        if (mHaveTraceBuf2Messages){return;}
+        mTraceBuf2Messages.clear();
+        mTraceBuf2Messages.reserve(mTraceBuf2Views.size());
+        for (const auto &view : mTraceBuf2Views)
+        {
+            try
+            {
+                mTraceBuf2Messages.push_back(view.toTraceBuf2());
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::get("deduplicator")->warn(
+                    "Failed to unpack message.  Failed with: "
+                  + std::string {e.what()});
+            }
+        }
+        mHaveTraceBuf2Messages = true;
+    }
+    /// Views of the earthworm messages in the slab
+    std::vector<TraceBuf2View> mTraceBuf2Views;
+    /// Earthworm messages.  These are only created when requested.
     std::vector<TraceBuf2> mTraceBuf2Messages;
+    /// The raw messages copied off the ring.  This is reused between reads.
+    MessageSlab mMessageSlab;
     /// Logos to scrounge from the ring.
     std::vector<MSG_LOGO> mLogos;
     std::string mRingName;
@@ -83,6 +121,12 @@ public:
     bool mHaveRegion{false};
     /// Connected?
     bool mConnected{false};
+    /// Have the traceBuf2 messages been unpacked from the views?
+    bool mHaveTraceBuf2Messages{false};
+    /// Rejects expired and future messages while reading
+    TimeWindow mTimeWindow;
+    /// Records the messages read from the ring
+    std::unique_ptr<CaptureRecorder> mCaptureRecorder;
 };
 
 /// C'tor
@@ -114,6 +158,20 @@ WaveRing::~WaveRing()
 /// Disconnects
 void WaveRing::disconnect() noexcept
 {
+    // Nothing to do for a ring that was moved
+    if (!pImpl){return;}
+    if (pImpl->mCaptureRecorder)
+    {
+        try
+        {
+            pImpl->mCaptureRecorder->stop();
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::get("deduplicator")->error(e.what());
+        }
+        pImpl->mCaptureRecorder = nullptr;
+    }
 #ifdef WITH_EARTHWORM
     if (pImpl->mHaveRegion)
     {
@@ -121,7 +179,10 @@ void WaveRing::disconnect() noexcept
         tport_detach(&pImpl->mRegion);
     }
     memset(&pImpl->mRegion, 0, sizeof(SHM_INFO));
+    pImpl->mTraceBuf2Views.clear();
     pImpl->mTraceBuf2Messages.clear();
+    pImpl->mHaveTraceBuf2Messages = false;
+    pImpl->mMessageSlab.release();
     pImpl->mLogos.clear();
     pImpl->mRingName.clear();
     pImpl->mRingKey = 0;
@@ -244,7 +305,7 @@ void WaveRing::connect(const std::string &ringName,
     pImpl->mProcessIdentifier = getpid();
     pImpl->mConnected = true;
     // Optimization -> reserve some space
-    pImpl->mTraceBuf2Messages.reserve(1024);
+    pImpl->mTraceBuf2Views.reserve(1024);
     spdlog::get("deduplicator")->info("Connect to " + ringName + "!");
 #endif
 }
@@ -255,6 +316,13 @@ bool WaveRing::isConnected() const noexcept
     return pImpl->mConnected;
 }
 
+/// Ring name
+std::string WaveRing::getRingName() const
+{
+    if (!isConnected()){throw std::runtime_error("Not connected to a ring");}
+    return pImpl->mRingName;
+}
+
 /// Writes a heartbeat message to the ring
 void WaveRing::writeHeartbeat(const bool terminate)
 {
@@ -293,6 +361,14 @@ void WaveRing::writeHeartbeat(const bool terminate)
 
 /// Writes message to the ring
 void WaveRing::write(const TraceBuf2 &message)
+{
+    auto messagePtr = message.getNativePacketPointer();
+    if (messagePtr == nullptr){throw std::invalid_argument("No message");}
+    write(TraceBuf2View {messagePtr, message.getMessageLength()});
+}
+
+/// Writes message to the ring
+void WaveRing::write(const TraceBuf2View &message)
 {
     if (!haveEarthworm()){throw std::runtime_error("Recompile with earthworm");}
     if (!isConnected()){throw std::runtime_error("Not to connected to a ring");}
@@ -301,51 +377,97 @@ void WaveRing::write(const TraceBuf2 &message)
     logo.instid = pImpl->mInstallationIdentifier; //mInstallationWildCard;
     logo.mod = pImpl->mModuleIdentifier;
     logo.type = pImpl->mTraceBuffer2Type;
-    std::array<char, MAX_TRACEBUF_SIZ> output;
-    auto messageLength = message.getMessageLength();
-    auto messagePtr = message.getNativePacketPointer();
-    std::copy(messagePtr, messagePtr + messageLength, output.begin());
-    std::fill(output.begin() + messageLength, 
-              output.end(),
-              '\0');
-    auto result = tport_putmsg(&pImpl->mRegion, &logo,
-                               messageLength, output.data());
+    // Earthworm does not modify the message but its API is not const
+    auto result
+        = tport_putmsg(&pImpl->mRegion, &logo,
+                       message.getMessageLength(),
+                       const_cast<char *> (message.getNativePacketPointer()));
     if (result != PUT_OK)
     {
-        auto name = message.getNetwork() + "." 
-                  + message.getStation() + "."
-                  + message.getChannel();
-        auto location = message.getLocationCode();
-        if (!location.empty()){name = name + "." + location;}
-        throw std::runtime_error("Failed to put " + name + " onto ring");
+        throw std::runtime_error("Failed to put "
+                               + message.getChannelKey().toName()
+                               + " onto ring");
+    }
+}
+
+/// Writes messages to the ring
+WriteSummary WaveRing::writeBatch(const std::span<const TraceBuf2View> messages)
+{
+    if (!haveEarthworm()){throw std::runtime_error("Recompile with earthworm");}
+    if (!isConnected()){throw std::runtime_error("Not to connected to a ring");}
+    WriteSummary summary;
+    auto start = std::chrono::steady_clock::now();
+    MSG_LOGO logo;
+    std::memset(&logo, 0, sizeof(MSG_LOGO));
+    logo.instid = pImpl->mInstallationIdentifier;
+    logo.mod = pImpl->mModuleIdentifier;
+    logo.type = pImpl->mTraceBuffer2Type;
+    for (const auto &message : messages)
+    {
+        // Earthworm does not modify the message but its API is not const
+        auto result
+            = tport_putmsg(&pImpl->mRegion, &logo,
+                           message.getMessageLength(),
+                           const_cast<char *>
+                           (message.getNativePacketPointer()));
+        if (result == PUT_OK)
+        {
+            summary.nWritten = summary.nWritten + 1;
+        }
+        else
+        {
+            summary.nFailed = summary.nFailed + 1;
+        }
     }
+    summary.duration
+        = std::chrono::duration_cast<std::chrono::microseconds>
+          (std::chrono::steady_clock::now() - start);
+    return summary;
 }
 
 /// Reads message from the ring
 void WaveRing::read()
 {
+    pImpl->mTraceBuf2Messages.clear();
+    pImpl->mHaveTraceBuf2Messages = false;
+    read(&pImpl->mMessageSlab, &pImpl->mTraceBuf2Views);
+}
+
+/// Reads message from the ring into the caller's slab
+void WaveRing::read(MessageSlab *messageSlab,
+                    std::vector<TraceBuf2View> *traceBuf2Views)
+{
+    if (messageSlab == nullptr)
+    {
+        throw std::invalid_argument("messageSlab is NULL");
+    }
+    if (traceBuf2Views == nullptr)
+    {
+        throw std::invalid_argument("traceBuf2Views is NULL");
+    }
     if (!haveEarthworm()){throw std::runtime_error("Recompile with earthworm");}
 #ifdef WITH_EARTHWORM
     if (!isConnected()){throw std::runtime_error("Not to connected to a ring");}
     // The algorithm works as follows:
     //  (1) Take the information off the ring as fast as possible.
     //  (2) Unpack the tracebuffers
-    // To do (1) first attempt to allocate enough space. 
+    // To do (1) we copy each message straight into the slab.  The slab's
+    // memory survives between reads so after the first few scrapes this
+    // does not allocate.
     int nWork = std::max(1024, pImpl->mMostWavesRead);
-    std::vector<std::array<char, MAX_TRACEBUF_SIZ>> messageWork;
-    std::vector<unsigned char> messageType;
-    std::vector<long> messageLength;
-    messageWork.reserve(nWork);
-    messageType.reserve(nWork);
-    messageLength.reserve(nWork);
-    pImpl->mTraceBuf2Messages.resize(0);
+    auto &slab = *messageSlab;
+    slab.clear();
+    slab.reserve(0, nWork);
+    traceBuf2Views->clear();
+    auto &timeWindow = pImpl->mTimeWindow;
+    if (timeWindow.isEnabled()){timeWindow.update(::getNow());}
     // Now copy the (unpacked) messages from the ring
-    std::array<char, MAX_TRACEBUF_SIZ> msg;
     MSG_LOGO gotLogo;
     long gotSize = 0;
     int returnCode = 0;
     unsigned char sequenceNumber;
     int nRead = 0;
+    auto capture = pImpl->mCaptureRecorder.get();
     auto start = std::chrono::high_resolution_clock::now();
     while(true)
     {
@@ -359,16 +481,24 @@ void WaveRing::read()
             disconnect();
             throw TerminateException(error);//std::runtime_error(error);
         }
-        // Copy the ring message
-        std::fill(msg.begin(), msg.end(), '\0');
+        // Copy the ring message directly into the slab
+        auto messagePtr = slab.beginMessage(MAX_TRACEBUF_SIZ);
         returnCode = tport_copyfrom(&pImpl->mRegion,
                                     pImpl->mLogos.data(),
                                     pImpl->mLogos.size(),
                                     &gotLogo, &gotSize,
-                                    msg.data(), MAX_TRACEBUF_SIZ,
+                                    messagePtr, MAX_TRACEBUF_SIZ,
                                     &sequenceNumber);
         // Are we done?
         if (returnCode == GET_NONE){break;}
+        // Everything but a message that was too big was copied.  Record it
+        // before it is checked so the capture is what the ring delivered.
+        if (capture != nullptr && returnCode != GET_TOOBIG)
+        {
+            capture->record(messagePtr, static_cast<size_t> (gotSize),
+                            gotLogo.instid, gotLogo.mod, gotLogo.type,
+                            sequenceNumber, ::getNow());
+        }
         // Handle earthworm errors
         if (returnCode != GET_OK)
         {
@@ -403,23 +533,24 @@ void WaveRing::read()
             }
             continue;
         }
-        // Unpack the tracebuf2 type message
+        // Keep the tracebuf2 type message
         if (gotLogo.type == pImpl->mTraceBuffer2Type)
         {
-            // Note, there's an optimization to be had by only copying 
-            // gotSize bytes.  But for now, this is simple in terms of
-            // memory (re)allocation.
-            messageWork.push_back(msg);
-            messageType.push_back(gotLogo.type);
-            messageLength.push_back(gotSize);
+            // Not committing lets the next message overwrite this one.  This
+            // matters after an outage when most of the ring is expired.
+            if (timeWindow.isEnabled() &&
+                timeWindow.reject(messagePtr, static_cast<size_t> (gotSize),
+                                  ::getNow))
+            {
+                continue;
+            }
+            slab.commitMessage(gotSize, gotLogo.type);
         }
 #ifdef WITH_MSEED
         else if (gotLogo.type == pImpl->mMSEEDType)
         {
             spdlog::get("deduplicator")->error("MSEED message not handled");
-            messageWork.push_back(msg);
-            messageType.push_back(gotLogo.type);
-            messageLength.push_back(gotSize);
+            slab.commitMessage(gotSize, gotLogo.type);
         }
 #endif
         else
@@ -431,66 +562,46 @@ void WaveRing::read()
     }
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsedTime = std::chrono::duration<double> (end - start).count();
+    if (capture != nullptr){capture->flush();}
     if (pImpl->mMilliSecondsWait > 0){sleep_ew(pImpl->mMilliSecondsWait);}
     // Update our typical allocation size
-    pImpl->mMostWavesRead = std::max(pImpl->mMostWavesRead, 
-                                     static_cast<int> (messageWork.size()));
-    // Step 2: Unpack the messages as fast as possible
-    auto nTraceBuf2Messages = std::count(messageType.begin(),
-                                         messageType.end(),
-                                         pImpl->mTraceBuffer2Type);
-    if (nTraceBuf2Messages > 0)
+    pImpl->mMostWavesRead = std::max(pImpl->mMostWavesRead, slab.size());
+    // Step 2: Create views of the messages.  This does not copy.
+    start = std::chrono::high_resolution_clock::now();
+    auto &views = *traceBuf2Views;
+    for (int it = 0; it < slab.size(); ++it)
     {
-        start = std::chrono::high_resolution_clock::now();
-        pImpl->mTraceBuf2Messages.resize(messageWork.size());
-        for (int it = 0; it < static_cast<int> (messageWork.size()); ++it)
+        if (slab.getMessageType(it) == pImpl->mTraceBuffer2Type)
         {
-            if (messageType[it] == pImpl->mTraceBuffer2Type)
+            auto message = slab.getMessage(it);
+            try
             {
-                try
-                {
-                    pImpl->mTraceBuf2Messages[it].fromEarthworm(
-                        messageWork[it].data(),
-                        messageLength[it]);
-                }
-                catch (const std::exception &e)
-                {
-                    spdlog::get("deduplicator")->warn(
-                        "Failed to unpack message.  Failed with: "
-                      + std::string {e.what()});
-                    continue;
-                }
+                TraceBuf2View view{message.data(), message.size()};
+                // Evict any empty messages
+                if (view.getNumberOfSamples() > 0){views.push_back(view);}
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::get("deduplicator")->warn(
+                    "Failed to unpack message.  Failed with: "
+                  + std::string {e.what()});
+                continue;
             }
         }
-        // Evict any empty messages
-        pImpl->mTraceBuf2Messages.erase(
-            std::remove_if(pImpl->mTraceBuf2Messages.begin(),
-                           pImpl->mTraceBuf2Messages.end(),
-                           [](const TraceBuf2 &tb2)
-                           {
-                              return tb2.getNumberOfSamples() == 0;
-                           }),
-                           pImpl->mTraceBuf2Messages.end());
-        end = std::chrono::high_resolution_clock::now();
-        elapsedTime = std::chrono::duration<double> (end - start).count();
     }
+    end = std::chrono::high_resolution_clock::now();
+    elapsedTime = std::chrono::duration<double> (end - start).count();
 #ifdef WITH_MSEED
-    auto nMSEEDMessages = std::count(messageType.begin(),
-                                     messageType.end(),
-                                     pImpl->mMSEEDType);
-    if (nMSEEDMessages > 0)
+    for (int it = 0; it < slab.size(); ++it)
     {
-        spdlog::get("deduplicator")->error(
-            "Need loop to upnack MSEED messages with msr_unpack");
-        for (int it = 0; it < static_cast<int> (messageWork.size()); ++it)
+        if (slab.getMessageType(it) == pImpl->mMSEEDType)
         {
-            if (messageType[it] == pImpl->mMSEEDType)
-            {
-                MS3Record *msr = nullptr;
-                auto size = messageWork[it].size();
-                msr3_parse(messageWork[it].data(), size, &msr, 1, 0);
-                msr3_free(&msr);
-            }
+            spdlog::get("deduplicator")->error(
+                "Need loop to upnack MSEED messages with msr_unpack");
+            MS3Record *msr = nullptr;
+            auto message = slab.getMessage(it);
+            msr3_parse(message.data(), message.size(), &msr, 1, 0);
+            msr3_free(&msr);
         }
     }
 #endif
@@ -524,7 +635,56 @@ void WaveRing::flush()
     spdlog::get("deduplicator")->debug("Flushed " + std::to_string(nMessages));
     if (pImpl->mMilliSecondsWait > 0){sleep_ew(pImpl->mMilliSecondsWait);}
 #endif
+    pImpl->mTraceBuf2Views.clear();
     pImpl->mTraceBuf2Messages.clear();
+    pImpl->mHaveTraceBuf2Messages = false;
+    pImpl->mMessageSlab.clear();
+}
+
+/// Time window
+void WaveRing::setTimeWindow(const std::chrono::seconds &maximumPastTime,
+                             const std::chrono::seconds &maximumFutureTime)
+{
+    pImpl->mTimeWindow.set(maximumPastTime, maximumFutureTime);
+}
+
+bool WaveRing::haveTimeWindow() const noexcept
+{
+    return pImpl->mTimeWindow.isEnabled();
+}
+
+/// Rejected channels
+std::vector<std::string> WaveRing::getExpiredChannels() const
+{
+    return pImpl->mTimeWindow.getExpiredChannels();
+}
+
+std::vector<std::string> WaveRing::getFutureChannels() const
+{
+    return pImpl->mTimeWindow.getFutureChannels();
+}
+
+void WaveRing::clearRejectedChannels() noexcept
+{
+    pImpl->mTimeWindow.clearRejectedChannels();
+}
+
+/// Capture
+void WaveRing::setCaptureRecorder(std::unique_ptr<CaptureRecorder> &&recorder)
+{
+    if (pImpl->mCaptureRecorder){pImpl->mCaptureRecorder->stop();}
+    pImpl->mCaptureRecorder = std::move(recorder);
+}
+
+bool WaveRing::haveCaptureRecorder() const noexcept
+{
+    return pImpl->mCaptureRecorder != nullptr;
+}
+
+/// Clock
+std::chrono::microseconds WaveRing::getNow() const noexcept
+{
+    return ::getNow();
 }
 
 /// Have earthworm?
@@ -539,31 +699,47 @@ bool WaveRing::haveEarthworm() const noexcept
 
 /// Get tracebuf2 messages
 std::vector<TraceBuf2> 
-    WaveRing::getTraceBuf2Messages() const noexcept
+    WaveRing::getTraceBuf2Messages() const
 {
+    pImpl->materializeTraceBuf2Messages();
     return pImpl->mTraceBuf2Messages;
 }
 
-const TraceBuf2 *WaveRing::getTraceBuf2MessagesPointer() const noexcept
+const TraceBuf2 *WaveRing::getTraceBuf2MessagesPointer() const
 {
+    pImpl->materializeTraceBuf2Messages();
     return pImpl->mTraceBuf2Messages.data();
 }
 
 const std::vector<TraceBuf2>
-&WaveRing::getTraceBuf2MessagesReference() const noexcept
+&WaveRing::getTraceBuf2MessagesReference() const
 {
+    pImpl->materializeTraceBuf2Messages();
     return pImpl->mTraceBuf2Messages;
 }
 
-std::vector<TraceBuf2> WaveRing::moveTraceBuf2Messages() noexcept
+std::vector<TraceBuf2> WaveRing::moveTraceBuf2Messages()
 {
+    pImpl->materializeTraceBuf2Messages();
     auto result = std::move(pImpl->mTraceBuf2Messages);
     std::vector<TraceBuf2> newMessages;
     pImpl->mTraceBuf2Messages = newMessages;
+    pImpl->mTraceBuf2Views.clear();
     return result;
 }
 
 int WaveRing::getNumberOfTraceBuf2Messages() const noexcept
 {
-    return static_cast<int> (pImpl->mTraceBuf2Messages.size());
+    return static_cast<int> (pImpl->mTraceBuf2Views.size());
+}
+
+const std::vector<TraceBuf2View>
+&WaveRing::getTraceBuf2ViewsReference() const noexcept
+{
+    return pImpl->mTraceBuf2Views;
+}
+
+const MessageSlab &WaveRing::getMessageSlabReference() const noexcept
+{
+    return pImpl->mMessageSlab;
 }